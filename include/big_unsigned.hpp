@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "int128.hpp"
+
+// arbitrary precision unsigned integer, 32-bit limbs with the least significant first
+class big_unsigned {
+public:
+	big_unsigned(std::uint64_t value = 0) {
+		while (value != 0) {
+			limbs.push_back(static_cast<std::uint32_t>(value));
+			value >>= 32;
+		}
+	}
+
+	big_unsigned& operator+=(const big_unsigned& other) {
+		std::uint64_t carry = 0;
+
+		if (limbs.size() < other.limbs.size()) {
+			limbs.resize(other.limbs.size(), 0);
+		}
+
+		for (std::size_t i = 0; i < limbs.size() && (i < other.limbs.size() || carry != 0); i++) {
+			carry += static_cast<std::uint64_t>(limbs[i]) + (i < other.limbs.size() ? other.limbs[i] : 0);
+			limbs[i] = static_cast<std::uint32_t>(carry);
+			carry >>= 32;
+		}
+
+		if (carry != 0) {
+			limbs.push_back(static_cast<std::uint32_t>(carry));
+		}
+
+		return *this;
+	}
+
+	friend big_unsigned operator+(big_unsigned left, const big_unsigned& right) {
+		return left += right;
+	}
+
+	friend big_unsigned operator*(const big_unsigned& left, const big_unsigned& right) {
+		big_unsigned product;
+
+		if (left.limbs.empty() || right.limbs.empty()) {
+			return product;
+		}
+
+		product.limbs.assign(left.limbs.size() + right.limbs.size(), 0);
+
+		for (std::size_t i = 0; i < left.limbs.size(); i++) {
+			std::uint64_t carry = 0;
+
+			for (std::size_t j = 0; j < right.limbs.size(); j++) {
+				carry += static_cast<std::uint64_t>(left.limbs[i]) * right.limbs[j] + product.limbs[i + j];
+				product.limbs[i + j] = static_cast<std::uint32_t>(carry);
+				carry >>= 32;
+			}
+
+			product.limbs[i + right.limbs.size()] = static_cast<std::uint32_t>(carry);
+		}
+
+		while (!product.limbs.empty() && product.limbs.back() == 0) {
+			product.limbs.pop_back();
+		}
+
+		return product;
+	}
+
+	big_unsigned& operator*=(const big_unsigned& other) {
+		return *this = *this * other;
+	}
+
+	friend bool operator==(const big_unsigned& left, const big_unsigned& right) {
+		return left.limbs == right.limbs;
+	}
+
+	friend bool operator!=(const big_unsigned& left, const big_unsigned& right) {
+		return !(left == right);
+	}
+
+	std::uint64_t remainder(std::uint64_t divisor) const {
+		uint128 rest = 0;
+
+		for (auto limb = limbs.rbegin(); limb != limbs.rend(); ++limb) {
+			rest = ((rest << 32) | *limb) % divisor;
+		}
+
+		return static_cast<std::uint64_t>(rest);
+	}
+
+	std::string to_string() const {
+		std::vector<std::uint32_t> rest(limbs);
+		std::string digits;
+
+		// peel off 9 decimal digits at a time
+		while (!rest.empty()) {
+			std::uint64_t remainder = 0;
+
+			for (auto limb = rest.rbegin(); limb != rest.rend(); ++limb) {
+				std::uint64_t current = (remainder << 32) | *limb;
+				*limb = static_cast<std::uint32_t>(current / 1000000000);
+				remainder = current % 1000000000;
+			}
+
+			while (!rest.empty() && rest.back() == 0) {
+				rest.pop_back();
+			}
+
+			for (int i = 0; i < 9 && (!rest.empty() || remainder != 0); i++) {
+				digits.push_back(static_cast<char>('0' + remainder % 10));
+				remainder /= 10;
+			}
+		}
+
+		if (digits.empty()) {
+			digits.push_back('0');
+		}
+
+		std::reverse(digits.begin(), digits.end());
+		return digits;
+	}
+
+private:
+	std::vector<std::uint32_t> limbs;
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const big_unsigned& value) {
+	return stream << value.to_string();
+}
@@ -13,3 +13,15 @@ inline std::ifstream open_dataset(const std::string& path) {
 
 	return file;
 }
+
+inline std::string read_dataset(const std::string& path) {
+	auto file = open_dataset(path);
+	std::string buffer;
+
+	file.seekg(0, std::ios::end);
+	buffer.resize(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	file.read(buffer.data(), buffer.size());
+
+	return buffer;
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// open addressing over groups of 16 control bytes, one per slot: empty, or 7 bits of the key's hash
+// slots are one flat array, so lookups touch one group and iteration walks memory in order
+// there is no erase, clear() empties the table but keeps its memory
+template<typename Key, typename Slot>
+class flat_hash_table {
+	static_assert(std::is_integral_v<Key>, "keys are hashed as integers");
+
+public:
+	template<bool Const>
+	class basic_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Slot;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<Const, const Slot*, Slot*>;
+		using reference = std::conditional_t<Const, const Slot&, Slot&>;
+
+		basic_iterator(const std::int8_t* controls, pointer slots, std::size_t index, std::size_t capacity)
+			: controls(controls), slots(slots), index(index), capacity(capacity) {
+			skip();
+		}
+
+		reference operator*() const {
+			return slots[index];
+		}
+
+		pointer operator->() const {
+			return slots + index;
+		}
+
+		basic_iterator& operator++() {
+			index += 1;
+			skip();
+			return *this;
+		}
+
+		basic_iterator operator++(int) {
+			basic_iterator previous = *this;
+			++*this;
+			return previous;
+		}
+
+		friend bool operator==(const basic_iterator& left, const basic_iterator& right) {
+			return left.index == right.index;
+		}
+
+		friend bool operator!=(const basic_iterator& left, const basic_iterator& right) {
+			return left.index != right.index;
+		}
+
+	private:
+		const std::int8_t* controls;
+		pointer slots;
+		std::size_t index;
+		std::size_t capacity;
+
+		void skip() {
+			while (index < capacity && controls[index] == vacant) {
+				index += 1;
+			}
+		}
+	};
+
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+	std::size_t size() const {
+		return used;
+	}
+
+	bool empty() const {
+		return used == 0;
+	}
+
+	// makes room for count keys without growing again
+	void reserve(std::size_t count) {
+		std::size_t capacity = group_width;
+
+		while (capacity - capacity / 8 < count) {
+			capacity *= 2;
+		}
+
+		if (capacity > controls.size()) {
+			rehash(capacity);
+		}
+	}
+
+	void clear() {
+		std::fill(controls.begin(), controls.end(), vacant);
+		used = 0;
+	}
+
+	iterator begin() {
+		return { controls.data(), slots.data(), 0, controls.size() };
+	}
+
+	iterator end() {
+		return { controls.data(), slots.data(), controls.size(), controls.size() };
+	}
+
+	const_iterator begin() const {
+		return { controls.data(), slots.data(), 0, controls.size() };
+	}
+
+	const_iterator end() const {
+		return { controls.data(), slots.data(), controls.size(), controls.size() };
+	}
+
+	iterator find(Key key) {
+		auto [index, found] = locate(key);
+		return found ? iterator(controls.data(), slots.data(), index, controls.size()) : end();
+	}
+
+	const_iterator find(Key key) const {
+		auto [index, found] = locate(key);
+		return found ? const_iterator(controls.data(), slots.data(), index, controls.size()) : end();
+	}
+
+	std::size_t count(Key key) const {
+		return locate(key).second ? 1 : 0;
+	}
+
+protected:
+	// the slot holding key, inserted with a value-initialized value if it was absent
+	std::pair<iterator, bool> try_insert(Key key) {
+		if (used + 1 > controls.size() - controls.size() / 8) {
+			rehash(controls.empty() ? group_width : 2 * controls.size());
+		}
+
+		auto [index, found] = locate(key);
+
+		if (!found) {
+			controls[index] = static_cast<std::int8_t>(hash(key) & 0x7F);
+
+			if constexpr (std::is_same_v<Slot, Key>) {
+				slots[index] = key;
+			} else {
+				slots[index] = Slot { key, {} };
+			}
+
+			used += 1;
+		}
+
+		return { iterator(controls.data(), slots.data(), index, controls.size()), !found };
+	}
+
+private:
+	static constexpr std::size_t group_width = 16;
+	static constexpr std::int8_t vacant = -128;
+
+	std::vector<std::int8_t> controls;
+	std::vector<Slot> slots;
+	std::size_t used = 0;
+
+	static std::uint64_t hash(Key key) {
+		// splitmix64 finalizer, consecutive keys land in unrelated groups
+		std::uint64_t x = static_cast<std::uint64_t>(key);
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+		return x ^ (x >> 31);
+	}
+
+	static const Key& key_of(const Slot& slot) {
+		if constexpr (std::is_same_v<Slot, Key>) {
+			return slot;
+		} else {
+			return slot.first;
+		}
+	}
+
+	// bit i is set iff group[i] == control
+	static std::uint32_t match(const std::int8_t* group, std::int8_t control) {
+#ifdef __SSE2__
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(control))));
+#else
+		std::uint32_t bits = 0;
+
+		for (std::size_t i = 0; i < group_width; i++) {
+			bits |= static_cast<std::uint32_t>(group[i] == control) << i;
+		}
+
+		return bits;
+#endif
+	}
+
+	// the slot holding key, or else the empty slot it belongs in
+	// groups are probed triangularly, which visits every group of a power of two table, and 1/8 of slots stay empty
+	std::pair<std::size_t, bool> locate(Key key) const {
+		if (controls.empty()) {
+			return { 0, false };
+		}
+
+		std::uint64_t hashed = hash(key);
+		auto control = static_cast<std::int8_t>(hashed & 0x7F);
+		std::size_t groups = controls.size() / group_width;
+		std::size_t group = (hashed >> 7) & (groups - 1);
+
+		for (std::size_t probe = 1;; probe++) {
+			const std::int8_t* base = controls.data() + group * group_width;
+
+			for (std::uint32_t bits = match(base, control); bits != 0; bits &= bits - 1) {
+				std::size_t index = group * group_width + __builtin_ctz(bits);
+
+				if (key_of(slots[index]) == key) {
+					return { index, true };
+				}
+			}
+
+			// keys are never erased, so the first group with an empty slot ends the search
+			if (std::uint32_t bits = match(base, vacant); bits != 0) {
+				return { group * group_width + __builtin_ctz(bits), false };
+			}
+
+			group = (group + probe) & (groups - 1);
+		}
+	}
+
+	void rehash(std::size_t capacity) {
+		std::vector<std::int8_t> oldControls(capacity, vacant);
+		std::vector<Slot> oldSlots(capacity);
+		controls.swap(oldControls);
+		slots.swap(oldSlots);
+
+		for (std::size_t i = 0; i < oldControls.size(); i++) {
+			if (oldControls[i] != vacant) {
+				std::size_t index = locate(key_of(oldSlots[i])).first;
+				controls[index] = oldControls[i];
+				slots[index] = std::move(oldSlots[i]);
+			}
+		}
+	}
+};
+
+template<typename Key>
+class flat_hash_set : public flat_hash_table<Key, Key> {
+public:
+	flat_hash_set() = default;
+
+	template<typename Iterator>
+	flat_hash_set(Iterator first, Iterator last) {
+		this->reserve(static_cast<std::size_t>(std::distance(first, last)));
+
+		for (; first != last; ++first) {
+			insert(*first);
+		}
+	}
+
+	std::pair<typename flat_hash_set::iterator, bool> insert(Key key) {
+		return this->try_insert(key);
+	}
+};
+
+// slots are std::pair<Key, Value>, the key of a slot must not be modified through an iterator
+template<typename Key, typename Value>
+class flat_hash_map : public flat_hash_table<Key, std::pair<Key, Value>> {
+public:
+	Value& operator[](Key key) {
+		return this->try_insert(key).first->second;
+	}
+
+	std::pair<typename flat_hash_map::iterator, bool> emplace(Key key, Value value) {
+		auto inserted = this->try_insert(key);
+
+		if (inserted.second) {
+			inserted.first->second = std::move(value);
+		}
+
+		return inserted;
+	}
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+__extension__ typedef __int128 int128;
+__extension__ typedef unsigned __int128 uint128;
+
+inline std::string to_string(uint128 value) {
+	std::string digits;
+
+	do {
+		digits.insert(digits.begin(), static_cast<char>('0' + static_cast<int>(value % 10)));
+		value /= 10;
+	} while (value != 0);
+
+	return digits;
+}
+
+inline std::string to_string(int128 value) {
+	return value < 0
+		? "-" + to_string(static_cast<uint128>(0) - static_cast<uint128>(value))
+		: to_string(static_cast<uint128>(value));
+}
+
+inline std::ostream& operator<<(std::ostream& stream, uint128 value) {
+	return stream << to_string(value);
+}
+
+inline std::ostream& operator<<(std::ostream& stream, int128 value) {
+	return stream << to_string(value);
+}
@@ -1,9 +1,9 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
-#include <unordered_set>
 #include <vector>
 #include "dataset.hpp"
+#include "flat_hash_map.hpp"
 
 using input = std::vector<long>;
 
@@ -29,7 +29,7 @@ int main() {
  * Space complexity: O(n)
 */
 long part1(const input& input) {
-	std::unordered_set<long> seen;
+	flat_hash_set<long> seen;
 
 	for (long value : input) {
 		long complement = 2020 - value;
@@ -49,7 +49,7 @@ long part1(const input& input) {
  * Space complexity: O(n)
 */
 long part2(const input& input) {
-	std::unordered_set<long> seen(input.begin(), input.end());
+	flat_hash_set<long> seen(input.begin(), input.end());
 
 	for (std::size_t i = 0; i < input.size(); i++) {
 		for (std::size_t j = i + 1; j < input.size(); j++) {
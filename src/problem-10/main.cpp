@@ -1,13 +1,190 @@
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
-#include <unordered_set>
+#include <stdexcept>
+#include <string>
 #include <vector>
+#include "big_unsigned.hpp"
 #include "dataset.hpp"
 
+// adapter joltages in ascending order
 using input = std::vector<long>;
 
+// arrangement counts modulo a prime, for when only the residue is needed
+template<std::uint64_t Modulus>
+struct modular {
+	static_assert(Modulus < (1UL << 32), "products must fit 64 bits");
+
+	std::uint64_t value;
+
+	modular(std::uint64_t value = 0) : value(value % Modulus) {}
+
+	modular& operator+=(const modular& other) {
+		value += other.value;
+		value -= value >= Modulus ? Modulus : 0;
+		return *this;
+	}
+
+	friend modular operator+(modular left, const modular& right) {
+		return left += right;
+	}
+
+	friend modular operator*(const modular& left, const modular& right) {
+		return modular(left.value * right.value);
+	}
+
+	friend std::ostream& operator<<(std::ostream& stream, const modular& number) {
+		return stream << number.value;
+	}
+};
+
+/** Arrangement count of a changing adapter set with joltages in [1, capacity].
+ * Walking the joltages upwards, (ways(x), ways(x - 1), ways(x - 2)) is a 3x3 matrix times the same vector at x - 1:
+ * present adapters add up the three ways below them, absent joltages are reached in 0 ways.
+ * A segment tree keeps the product of every joltage range, so inserting or erasing one adapter updates
+ * one leaf and its O(log n) ancestors, and the count is the product of the prefix up to the highest adapter.
+ */
+template<typename Count>
+class adapter_arrangements {
+public:
+	explicit adapter_arrangements(std::size_t capacity) : leaves(1) {
+		while (leaves < capacity) {
+			leaves *= 2;
+		}
+
+		this->capacity = capacity;
+		nodes.assign(2 * leaves, identity());
+		present.assign(2 * leaves, 0);
+
+		for (std::size_t i = 0; i < capacity; i++) {
+			nodes[leaves + i] = transition(false);
+		}
+
+		for (std::size_t node = leaves - 1; node > 0; node--) {
+			nodes[node] = nodes[2 * node + 1] * nodes[2 * node];
+		}
+	}
+
+	bool contains(long joltage) const {
+		return present[leaves + index(joltage)] != 0;
+	}
+
+	void insert(long joltage) {
+		update(index(joltage), true);
+	}
+
+	void erase(long joltage) {
+		update(index(joltage), false);
+	}
+
+	// ways from the outlet (0) to the device (3 above the highest adapter)
+	Count count() const {
+		if (present[1] == 0) {
+			return Count(1);
+		}
+
+		std::size_t node = 1;
+
+		while (node < leaves) {
+			node = present[2 * node + 1] != 0 ? 2 * node + 1 : 2 * node;
+		}
+
+		// product of the leaves [0, highest], later joltages multiply from the left
+		matrix left = identity();
+		matrix right = identity();
+
+		for (std::size_t low = leaves, high = node + 1; low < high; low /= 2, high /= 2) {
+			if (low & 1) {
+				left = nodes[low++] * left;
+			}
+
+			if (high & 1) {
+				right = right * nodes[--high];
+			}
+		}
+
+		// the outlet starts as (1, 0, 0), so the count is entry (0, 0)
+		Count ways(0);
+
+		for (std::size_t k = 0; k < 3; k++) {
+			ways += right.cells[k] * left.cells[3 * k];
+		}
+
+		return ways;
+	}
+
+private:
+	struct matrix {
+		std::array<Count, 9> cells;
+
+		friend matrix operator*(const matrix& left, const matrix& right) {
+			matrix product;
+
+			for (std::size_t row = 0; row < 3; row++) {
+				for (std::size_t column = 0; column < 3; column++) {
+					Count cell(0);
+
+					for (std::size_t k = 0; k < 3; k++) {
+						cell += left.cells[3 * row + k] * right.cells[3 * k + column];
+					}
+
+					product.cells[3 * row + column] = std::move(cell);
+				}
+			}
+
+			return product;
+		}
+	};
+
+	std::size_t leaves;
+	std::size_t capacity;
+	std::vector<matrix> nodes;
+	std::vector<std::uint32_t> present;
+
+	static matrix identity() {
+		return { { Count(1), Count(0), Count(0), Count(0), Count(1), Count(0), Count(0), Count(0), Count(1) } };
+	}
+
+	static matrix transition(bool adapter) {
+		Count top(adapter ? 1 : 0);
+		return { { top, top, top, Count(1), Count(0), Count(0), Count(0), Count(1), Count(0) } };
+	}
+
+	std::size_t index(long joltage) const {
+		if (joltage < 1 || static_cast<std::size_t>(joltage) > capacity) {
+			throw std::out_of_range("joltage out of range: " + std::to_string(joltage));
+		}
+
+		return static_cast<std::size_t>(joltage) - 1;
+	}
+
+	void update(std::size_t i, bool adapter) {
+		std::size_t node = leaves + i;
+
+		if ((present[node] != 0) == adapter) {
+			return;
+		}
+
+		nodes[node] = transition(adapter);
+		present[node] = adapter;
+
+		for (node /= 2; node > 0; node /= 2) {
+			nodes[node] = nodes[2 * node + 1] * nodes[2 * node];
+			present[node] = present[2 * node] + present[2 * node + 1];
+		}
+	}
+};
+
+// nothing in main keeps a changing adapter set, these keep both count types compiling
+template class adapter_arrangements<modular<1000000007>>;
+template class adapter_arrangements<big_unsigned>;
+
 static long part1(const input& input);
-static long part2(const input& input);
+static big_unsigned part2(const input& input);
+template<typename Count>
+static Count count_arrangements(const input& input);
+static void sort_joltages(input& input);
 
 int main() {
 	auto stream = open_dataset("data/problem-10.txt");
@@ -18,6 +195,7 @@ int main() {
 		input.push_back(value);
 	}
 
+	sort_joltages(input);
 	std::cout << "Part 1 Solution: " << part1(input) << "\n";
 	std::cout << "Part 2 Solution: " << part2(input) << "\n";
 	return 0;
@@ -25,43 +203,104 @@ int main() {
 
 /** Product of number of 1-jolt differences and number of 3-jolt differences.
  * Time complexity: O(n)
- * Space complexity: O(n)
+ * Space complexity: O(1)
 */
 long part1(const input& input) {
-	std::unordered_set<long> seen(input.begin(), input.end());
 	long oneJoltDifferences = 0;
 	long threeJoltDifferences = 1;
-	seen.insert(0);
+	long previous = 0;
 
 	for (long value : input) {
-		if (seen.count(value - 1) > 0) {
-			oneJoltDifferences += 1;
-		} else if (seen.count(value - 3) > 0) {
-			threeJoltDifferences += 1;
+		long difference = value - previous;
+
+		if (difference < 1 || difference > 3) {
+			throw std::runtime_error("Part 1: No Solution!");
 		}
+
+		oneJoltDifferences += difference == 1;
+		threeJoltDifferences += difference == 3;
+		previous = value;
 	}
 
 	return oneJoltDifferences * threeJoltDifferences;
 }
 
 /** Count the number of distinct ways the adapters can be arranged.
- * Time complexity: O(n)
- * Space complexity: O(n)
+ * Time complexity: O(n * b) [b = size of the count]
+ * Space complexity: O(b)
 */
-long part2(const input& input) {
-	long max = *std::max_element(input.begin(), input.end()) + 3;
-	std::vector<long> parentCount(max + 1, 0);
-	std::for_each(input.begin(), input.end(), [&](long value) { parentCount[value] = value; });
-	parentCount.at(0) = 1;
-	parentCount.at(max) = max;
+big_unsigned part2(const input& input) {
+	return count_arrangements<big_unsigned>(input);
+}
 
-	auto getParentCount = [&](long value) { return value >= 0 ? parentCount[value] : 0; };
+/** Counts the chains from the outlet (0) to the device (max + 3) through the sorted adapters.
+ * Only the last three values can be 3 jolts or less below the next one, so they are all the state kept.
+ * Count is big_unsigned for exact counts or modular<P> for counts modulo P.
+ * Time complexity: O(n) additions
+ * Space complexity: O(1) counts
+ */
+template<typename Count>
+Count count_arrangements(const input& input) {
+	// ways[k] reaches joltage values[k], slots rotate with index % 3
+	std::array<long, 3> values { 0, -4, -4 };
+	std::array<Count, 3> ways { Count(1), Count(0), Count(0) };
+	std::size_t last = 0;
 
-	for (long value : parentCount) {
-		if (value != 0) {
-			parentCount[value] = getParentCount(value - 1) + getParentCount(value - 2) + getParentCount(value - 3);
+	for (std::size_t i = 0; i <= input.size(); i++) {
+		// the device accepts 3 jolts above the highest adapter
+		long value = i < input.size() ? input[i] : values[last] + 3;
+		std::size_t slot = (last + 1) % 3;
+		Count current(0);
+
+		for (std::size_t k = 0; k < 3; k++) {
+			if (value - values[k] >= 1 && value - values[k] <= 3) {
+				current += ways[k];
+			}
 		}
+
+		values[slot] = value;
+		ways[slot] = std::move(current);
+		last = slot;
+	}
+
+	return ways[last];
+}
+
+/** Sorts the joltages ascending, by bytes with a radix sort when they fit 32 bits and a comparison sort otherwise.
+ * Time complexity: O(n * w) [w = bytes in the largest value] or O(n log n)
+ * Space complexity: O(n)
+ */
+void sort_joltages(input& input) {
+	if (input.empty()) {
+		return;
+	}
+
+	auto [minimum, maximum] = std::minmax_element(input.begin(), input.end());
+	long min = *minimum;
+	long max = *maximum;
+
+	if (min < 0 || max > static_cast<long>(UINT32_MAX) || input.size() < 64) {
+		std::sort(input.begin(), input.end());
+		return;
 	}
 
-	return parentCount.at(max);
+	std::vector<long> scratch(input.size());
+
+	for (unsigned long shift = 0; shift < 32 && (static_cast<unsigned long>(max) >> shift) != 0; shift += 8) {
+		std::array<std::size_t, 257> offsets {};
+
+		for (long value : input) {
+			offsets[((value >> shift) & 0xFF) + 1] += 1;
+		}
+
+		for (std::size_t digit = 0; digit < 256; digit++) {
+			offsets[digit + 1] += offsets[digit];
+		}
+
+		for (long value : input) {
+			scratch[offsets[(value >> shift) & 0xFF]++] = value;
+		}
+
+		input.swap(scratch);
+	}
 }
@@ -1,210 +1,844 @@
 #include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include "dataset.hpp"
 
-enum class seat_state { empty = 'L', occupied = '#', floor = '.' };
+enum class seat_state : std::uint8_t { empty = 'L', occupied = '#', floor = '.' };
 
-using state = std::vector<std::vector<seat_state>>;
+/** Leaves elements uninitialized, so the thread that first writes a page decides on which NUMA node it lives.
+ */
+template<typename T>
+struct first_touch_allocator : std::allocator<T> {
+	template<typename U>
+	struct rebind {
+		using other = first_touch_allocator<U>;
+	};
 
-static long part1(const state& state);
-static long part2(const state& state);
-static std::pair<bool, state> simulate_part1(const state& state);
-static std::pair<bool, state> simulate_part2(const state& state);
+	first_touch_allocator() = default;
 
-int main() {
-	auto stream = open_dataset("data/problem-11.txt");
-	state state;
-	std::string line;
+	template<typename U>
+	first_touch_allocator(const first_touch_allocator<U>&) {}
 
-	while (stream >> line) {
-		std::vector<seat_state> row;
+	template<typename U>
+	void construct(U* pointer) {
+		::new (static_cast<void*>(pointer)) U;
+	}
 
-		for (char ch : line) {
-			row.push_back(static_cast<seat_state>(ch));
+	template<typename U, typename... Args>
+	void construct(U* pointer, Args&&... args) {
+		::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+	}
+};
+
+using grid = std::vector<seat_state, first_touch_allocator<seat_state>>;
+
+// empty ^ flip_mask == occupied and the other way around
+constexpr std::uint8_t flip_mask = static_cast<std::uint8_t>(seat_state::empty) ^ static_cast<std::uint8_t>(seat_state::occupied);
+
+// one byte per cell in row-major order
+struct seat_map {
+	std::size_t rows;
+	std::size_t columns;
+	grid cells;
+};
+
+// seats seen from cell i are neighbors[offsets[i] .. offsets[i + 1]), floor cells see nothing
+struct neighbor_list {
+	std::vector<std::uint32_t> offsets;
+	std::vector<std::uint32_t> neighbors;
+};
+
+// a neighborhood shape lists its directions as { row, column } steps, and is symmetric: it contains -d for every d
+struct moore {
+	static constexpr std::array<std::array<long, 2>, 8> directions { {
+		{ -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, -1 }, { 0, 1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }
+	} };
+};
+
+struct von_neumann {
+	static constexpr std::array<std::array<long, 2>, 4> directions { { { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 0 } } };
+};
+
+/** Empty seats with at most Lonely occupied neighbors fill up, occupied seats with at least Crowded empty.
+ * Part 1 is seating_rule<4> and part 2 seating_rule<5>.
+ */
+template<std::size_t Crowded, std::size_t Lonely = 0>
+struct seating_rule {
+	static bool flips(seat_state state, std::size_t occupied) {
+		return (state == seat_state::empty && occupied <= Lonely) | (state == seat_state::occupied && occupied >= Crowded);
+	}
+};
+
+template<typename Shape>
+static neighbor_list find_neighbors(const seat_map& map, bool lineOfSight);
+
+// one step of a simulation: whether any seat changed, and how the state hash changed (xor)
+struct step_delta {
+	bool changed;
+	std::uint64_t hash;
+};
+
+// a simulation stopped after steps steps, in a state that repeats every period steps (1 for a fixpoint)
+struct settlement {
+	std::size_t steps;
+	std::size_t period;
+};
+
+/** Zobrist key of x, mixed on the fly (splitmix64 finalizer) instead of looked up in a table of random keys.
+ * A state hash is the xor of the keys of its parts, so a step only rehashes what flipped.
+ */
+constexpr std::uint64_t zobrist_key(std::uint64_t x) {
+	x += 0x9E3779B97F4A7C15UL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9UL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBUL;
+	return x ^ (x >> 31);
+}
+
+/** Brent's cycle detection on state hashes: the tortoise is one remembered hash, moved to the hare at every power of
+ * two, so finding a period costs O(1) memory. Two states with equal 64-bit hashes are taken to be equal.
+ */
+class cycle_detector {
+public:
+	explicit cycle_detector(std::uint64_t hash) : tortoise(hash), hare(hash), power(1), length(0) {}
+
+	// feeds one step, returns the period once the state repeats and 0 until then
+	std::size_t advance(const step_delta& delta) {
+		if (!delta.changed) {
+			return 1;
 		}
 
-		state.push_back(std::move(row));
+		hare ^= delta.hash;
+		length += 1;
+
+		if (hare == tortoise) {
+			return length;
+		}
+
+		if (length == power) {
+			tortoise = hare;
+			power *= 2;
+			length = 0;
+		}
+
+		return 0;
 	}
 
-	std::cout << "Part 1 Solution: " << part1(state) << "\n";
-	std::cout << "Part 2 Solution: " << part2(state) << "\n";
-	return 0;
-}
+private:
+	std::uint64_t tortoise;
+	std::uint64_t hare;
+	std::size_t power;
+	std::size_t length;
+};
 
-/** Continuously simulates the state until there are no changes and yields the number of occupied seats.
- * Time complexity: O(mn) [where m = # of simulations]
- * Space complexity: O(mn)
-*/
-long part1(const state& state) {
-	auto newState = state;
+/** Threads that stay alive between jobs, the calling thread takes part as thread 0.
+ * A job runs on every thread at once, and its threads can meet at wait(), a barrier over the whole team.
+ */
+class thread_team {
+public:
+	explicit thread_team(std::size_t size) : count(std::max<std::size_t>(size, 1)) {
+		for (std::size_t thread = 1; thread < count; thread++) {
+			workers.emplace_back([this, thread] { work(thread); });
+		}
+	}
 
-	while (true) {
-		auto pair = simulate_part1(newState);
-		newState = std::move(pair.second);
+	thread_team(const thread_team&) = delete;
+	thread_team& operator=(const thread_team&) = delete;
 
-		if (!pair.first) {
-			long occupied = 0;
+	~thread_team() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			jobGeneration += 1;
+		}
 
-			for (const auto& row : newState) {
-				for (seat_state st : row) {
-					if (st == seat_state::occupied) {
-						occupied += 1;
-					}
-				}
-			}
+		started.notify_all();
 
-			return occupied;
+		for (auto& worker : workers) {
+			worker.join();
 		}
 	}
-}
 
-/** Continuously simulates the state until there are no changes and yields the number of occupied seats.
- * Time complexity: O(mn^1.5) [where m = # of simulations]
- * Space complexity: O(mn^1.5)
-*/
-long part2(const state& state) {
-	auto newState = state;
+	std::size_t size() const {
+		return count;
+	}
 
-	while (true) {
-		auto pair = simulate_part2(newState);
-		newState = std::move(pair.second);
+	// rows [begin, end) of a band split of rows for thread
+	std::pair<std::size_t, std::size_t> band(std::size_t thread, std::size_t rows) const {
+		return { rows * thread / count, rows * (thread + 1) / count };
+	}
 
-		if (!pair.first) {
-			long occupied = 0;
+	// runs job(thread) on every thread and returns once all of them are done
+	void run(const std::function<void(std::size_t)>& job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			current = &job;
+			remaining = count - 1;
+			jobGeneration += 1;
+		}
 
-			for (const auto& row : newState) {
-				for (seat_state st : row) {
-					if (st == seat_state::occupied) {
-						occupied += 1;
+		started.notify_all();
+		job(0);
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [this] { return remaining == 0; });
+		current = nullptr;
+	}
+
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		std::size_t generation = barrierGeneration;
+
+		if (++arrived == count) {
+			arrived = 0;
+			barrierGeneration += 1;
+			lock.unlock();
+			released.notify_all();
+			return;
+		}
+
+		released.wait(lock, [this, generation] { return barrierGeneration != generation; });
+	}
+
+	/** Runs step(thread, s) for s = 0, 1, .. on every thread, with one barrier per step, until the state stops changing
+	 * or repeats. step returns the step_delta of its band, and hash is the hash of the starting state.
+	 * Every thread reduces the per-thread deltas and runs its own cycle_detector, so they all stop after the same step.
+	 */
+	template<typename Step>
+	settlement run_until_repeat(std::uint64_t hash, Step step) {
+		// deltas[s % 2] of step s is read after its barrier and only rewritten by step s + 2, past the next barrier
+		struct alignas(64) slot {
+			step_delta deltas[2];
+		};
+
+		std::vector<slot> threads(count);
+		settlement result { 0, 0 };
+
+		run([&](std::size_t thread) {
+			cycle_detector detector(hash);
+
+			for (std::size_t s = 0;; s++) {
+				threads[thread].deltas[s % 2] = step(thread, s);
+				wait();
+				step_delta delta { false, 0 };
+
+				for (const auto& other : threads) {
+					delta.changed |= other.deltas[s % 2].changed;
+					delta.hash ^= other.deltas[s % 2].hash;
+				}
+
+				std::size_t period = detector.advance(delta);
+
+				if (period != 0) {
+					if (thread == 0) {
+						result = { s + 1, period };
 					}
+
+					return;
+				}
+			}
+		});
+
+		return result;
+	}
+
+private:
+	std::size_t count;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable started;
+	std::condition_variable finished;
+	std::condition_variable released;
+	const std::function<void(std::size_t)>* current = nullptr;
+	std::size_t jobGeneration = 0;
+	std::size_t remaining = 0;
+	std::size_t arrived = 0;
+	std::size_t barrierGeneration = 0;
+	bool stopping = false;
+
+	void work(std::size_t thread) {
+		std::size_t seen = 0;
+
+		while (true) {
+			const std::function<void(std::size_t)>* job;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				started.wait(lock, [this, seen] { return jobGeneration != seen; });
+				seen = jobGeneration;
+
+				if (stopping) {
+					return;
 				}
+
+				job = current;
 			}
 
-			return occupied;
+			(*job)(thread);
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (--remaining == 0) {
+				finished.notify_one();
+			}
 		}
 	}
-}
+};
 
-/** Simulates the part 1 ruleset once and returns the state.
- * Time complexity: O(n)
- * Space complexity: O(n)
+/** Part 1 ruleset on 64 cells per word: bit c % 64 of word c / 64 of a row is column c.
+ * Rows have a zero word on both sides and the grid a zero row above and below, so every neighbor word exists.
+ * The 8 neighbors of all 64 cells are shifted into place and summed by full adders into 4 bit planes.
  */
-std::pair<bool, state> simulate_part1(const state& state) {
-	bool hasChanges = false;
-	auto newState = state;
-
-	auto getAdjacent = [&](long row, long col) {
-		std::vector<seat_state> adjacent;
-		adjacent.reserve(8);
-
-		for (long i = row - 1; i <= row + 1; i++) {
-			for (long j = col - 1; j <= col + 1; j++) {
-				if (!(i == row && j == col)
-					&& i >= 0 && i < static_cast<long>(state.size())
-					&& j >= 0 && j < static_cast<long>(state[i].size())
-				) {
-					adjacent.push_back(state[i][j]);
+class bit_automaton {
+public:
+	bit_automaton(const seat_map& map, thread_team& team)
+		: rows(map.rows),
+		columns(map.columns),
+		stride((map.columns + 63) / 64 + 2),
+		steps(0),
+		seats((map.rows + 2) * stride),
+		buffers { words(seats.size()), words(seats.size()) } {
+		// each thread first touches the rows it will step
+		team.run([&](std::size_t thread) {
+			auto [begin, end] = team.band(thread, rows + 2);
+
+			for (std::size_t r = begin; r < end; r++) {
+				std::fill_n(seats.data() + r * stride, stride, 0);
+				std::fill_n(buffers[0].data() + r * stride, stride, 0);
+				std::fill_n(buffers[1].data() + r * stride, stride, 0);
+
+				for (std::size_t c = 0; r > 0 && r <= rows && c < columns; c++) {
+					seat_state state = map.cells[(r - 1) * columns + c];
+					std::uint64_t bit = 1UL << (c % 64);
+					std::size_t w = r * stride + c / 64 + 1;
+					seats[w] |= state != seat_state::floor ? bit : 0;
+					buffers[0][w] |= state == seat_state::occupied ? bit : 0;
 				}
 			}
+		});
+	}
+
+	std::size_t height() const {
+		return rows;
+	}
+
+	// one step of the part 1 rules
+	step_delta step() {
+		return step_rows(0, rows, steps++);
+	}
+
+	// xor over words of the key of (word index, word), words that do not change cancel out of every step
+	std::uint64_t hash() const {
+		std::uint64_t hash = 0;
+
+		for (std::size_t w = 0; w < buffers[steps % 2].size(); w++) {
+			hash ^= word_key(w, buffers[steps % 2][w]);
 		}
 
-		return adjacent;
-	};
+		return hash;
+	}
 
-	for (long i = 0; i < static_cast<long>(state.size()); i++) {
-		for (long j = 0; j < static_cast<long>(state[i].size()); j++) {
-			if (state[i][j] == seat_state::empty) {
-				// Rule 1
-				auto adjacent = getAdjacent(i, j);
+	// counts steps run through step_rows by all threads
+	void advance(std::size_t count) {
+		steps += count;
+	}
 
-				if (std::count(adjacent.begin(), adjacent.end(), seat_state::occupied) == 0) {
-					newState[i][j] = seat_state::occupied;
-					hasChanges = true;
-				}
-			} else if (state[i][j] == seat_state::occupied) {
-				// Rule 2
-				auto adjacent = getAdjacent(i, j);
+	/** Rows [begin, end) of step s (counted from construction), reading buffer s % 2 and writing the other one.
+	 * Returns the step_delta of those rows.
+	 */
+	step_delta step_rows(std::size_t begin, std::size_t end, std::size_t s) {
+		const words& current = buffers[s % 2];
+		words& next = buffers[(s + 1) % 2];
+		std::uint64_t changed = 0;
+		std::uint64_t hash = 0;
+
+		for (std::size_t r = begin + 1; r <= end; r++) {
+			const std::uint64_t* up = current.data() + (r - 1) * stride;
+			const std::uint64_t* middle = current.data() + r * stride;
+			const std::uint64_t* down = current.data() + (r + 1) * stride;
+			const std::uint64_t* seat = seats.data() + r * stride;
+			std::uint64_t* out = next.data() + r * stride;
+
+			for (std::size_t w = 1; w + 1 < stride; w++) {
+				// bit c of west(row) is column c - 1, bit c of east(row) is column c + 1
+				auto west = [w](const std::uint64_t* row) { return (row[w] << 1) | (row[w - 1] >> 63); };
+				auto east = [w](const std::uint64_t* row) { return (row[w] >> 1) | (row[w + 1] << 63); };
+
+				auto [sum0, carry0] = full_adder(west(up), up[w], east(up));
+				auto [sum1, carry1] = full_adder(west(middle), east(middle), west(down));
+				std::uint64_t sum2 = down[w] ^ east(down);
+				std::uint64_t carry2 = down[w] & east(down);
+
+				// count = ones + 2 * twos + 4 * fours + 8 * eights
+				auto [ones, carry3] = full_adder(sum0, sum1, sum2);
+				auto [twos0, carry4] = full_adder(carry0, carry1, carry2);
+				std::uint64_t twos = twos0 ^ carry3;
+				std::uint64_t carry5 = twos0 & carry3;
+				std::uint64_t fours = carry4 ^ carry5;
+				std::uint64_t eights = carry4 & carry5;
+
+				// Rule 1 and Rule 2
+				std::uint64_t occupied = middle[w];
+				std::uint64_t none = ~(ones | twos | fours | eights);
+				std::uint64_t crowded = fours | eights;
+				out[w] = seat[w] & ((occupied & ~crowded) | (~occupied & none));
+				changed |= out[w] ^ occupied;
+				hash ^= word_key(r * stride + w, occupied) ^ word_key(r * stride + w, out[w]);
+			}
+		}
+
+		return { changed != 0, hash };
+	}
+
+	long count_occupied() const {
+		long occupied = 0;
+
+		for (std::uint64_t word : buffers[steps % 2]) {
+			occupied += __builtin_popcountll(word);
+		}
+
+		return occupied;
+	}
+
+	grid cells() const {
+		grid cells(rows * columns, seat_state::floor);
+
+		for (std::size_t r = 0; r < rows; r++) {
+			for (std::size_t c = 0; c < columns; c++) {
+				std::size_t w = (r + 1) * stride + c / 64 + 1;
+				bool isSeat = (seats[w] >> (c % 64)) & 1;
+				bool isOccupied = (buffers[steps % 2][w] >> (c % 64)) & 1;
+				cells[r * columns + c] = !isSeat ? seat_state::floor : isOccupied ? seat_state::occupied : seat_state::empty;
+			}
+		}
+
+		return cells;
+	}
 
-				if (std::count(adjacent.begin(), adjacent.end(), seat_state::occupied) >= 4) {
-					newState[i][j] = seat_state::empty;
-					hasChanges = true;
+private:
+	using words = std::vector<std::uint64_t, first_touch_allocator<std::uint64_t>>;
+
+	std::size_t rows;
+	std::size_t columns;
+	std::size_t stride;
+	std::size_t steps;
+	words seats;
+	std::array<words, 2> buffers;
+
+	static std::uint64_t word_key(std::size_t w, std::uint64_t word) {
+		return zobrist_key(word ^ zobrist_key(w));
+	}
+
+	static std::pair<std::uint64_t, std::uint64_t> full_adder(std::uint64_t a, std::uint64_t b, std::uint64_t c) {
+		std::uint64_t half = a ^ b;
+		return { half ^ c, (a & b) | (half & c) };
+	}
+};
+
+/** Seat rules over neighbor lists that only revisit cells whose neighborhood changed in the last step.
+ * Occupied neighbor counts are kept per cell and patched through the neighbor lists of the seats that flip,
+ * so a step costs O(changes) instead of O(n).
+ */
+template<typename Rule>
+class frontier_automaton {
+public:
+	frontier_automaton(const seat_map& map, neighbor_list neighbors)
+		: neighbors(std::move(neighbors)),
+		cells(map.cells),
+		counts(map.cells.size(), 0),
+		stamps(map.cells.size(), 0),
+		generation(0),
+		occupied(0),
+		state_hash(0) {
+		for (std::uint32_t i = 0; i < cells.size(); i++) {
+			if (cells[i] == seat_state::occupied) {
+				occupied += 1;
+				state_hash ^= zobrist_key(i);
+
+				for (std::uint32_t k = this->neighbors.offsets[i]; k < this->neighbors.offsets[i + 1]; k++) {
+					counts[this->neighbors.neighbors[k]] += 1;
 				}
 			}
+
+			if (cells[i] != seat_state::floor) {
+				worklist.push_back(i);
+			}
 		}
 	}
 
-	return { hasChanges, newState };
-}
+	// one step of Rule
+	step_delta step() {
+		std::uint64_t hash = 0;
+		flips.clear();
 
-/** Simulates the part 2 ruleset once and returns the state.
- * Time complexity: O(n^1.5)
- * Space complexity: O(n)
+		// decide every flip on the old state first, so the step stays synchronous
+		for (std::uint32_t i : worklist) {
+			if (Rule::flips(cells[i], counts[i])) {
+				flips.push_back(i);
+			}
+		}
+
+		worklist.clear();
+
+		if (++generation == 0) {
+			// generation wrapped, stale stamps could now look current
+			std::fill(stamps.begin(), stamps.end(), 0);
+			generation = 1;
+		}
+
+		for (std::uint32_t i : flips) {
+			bool nowOccupied = cells[i] == seat_state::empty;
+			cells[i] = nowOccupied ? seat_state::occupied : seat_state::empty;
+			occupied += nowOccupied ? 1 : -1;
+			hash ^= zobrist_key(i);
+			enqueue(i);
+
+			for (std::uint32_t k = neighbors.offsets[i]; k < neighbors.offsets[i + 1]; k++) {
+				std::uint32_t j = neighbors.neighbors[k];
+				counts[j] += nowOccupied ? 1 : -1;
+				enqueue(j);
+			}
+		}
+
+		state_hash ^= hash;
+		return { !flips.empty(), hash };
+	}
+
+	long count_occupied() const {
+		return occupied;
+	}
+
+	// xor of the keys of the occupied cells
+	std::uint64_t hash() const {
+		return state_hash;
+	}
+
+	const grid& state() const {
+		return cells;
+	}
+
+private:
+	neighbor_list neighbors;
+	grid cells;
+	std::vector<std::uint8_t> counts;
+	// stamps[i] == generation iff cell i is already on the worklist of the next step
+	std::vector<std::uint32_t> stamps;
+	std::uint32_t generation;
+	std::vector<std::uint32_t> worklist;
+	std::vector<std::uint32_t> flips;
+	long occupied;
+	std::uint64_t state_hash;
+
+	void enqueue(std::uint32_t i) {
+		if (stamps[i] != generation) {
+			stamps[i] = generation;
+			worklist.push_back(i);
+		}
+	}
+};
+
+// neither part settles on frontier_automaton, this keeps it compiling against the part 2 rule
+template class frontier_automaton<seating_rule<5>>;
+
+/** Counts the occupied cells at fixed offsets around a cell, unrolled over the directions of Shape.
+ * Needs a border of floor around the grid.
  */
-std::pair<bool, state> simulate_part2(const state& state) {
-	bool hasChanges = false;
-	auto newState = state;
-
-	auto getAdjacent = [&](long row, long col) {
-		std::vector<seat_state> adjacent;
-		adjacent.reserve(8);
-
-		for (long i = row - 1; i <= row + 1; i++) {
-			for (long j = col - 1; j <= col + 1; j++) {
-				if (!(i == row && j == col)
-					&& i >= 0 && i < static_cast<long>(state.size())
-					&& j >= 0 && j < static_cast<long>(state[i].size())
-				) {
-					if (state[i][j] == seat_state::floor) {
-						// scan if floor
-						long di = i - row;
-						long dj = j - col;
-						long i2 = i;
-						long j2 = j;
-
-						while (i2 >= 0 && i2 < static_cast<long>(state.size())
-							&& j2 >= 0 && j2 < static_cast<long>(state[i2].size())
-						) {
-							if (state[i2][j2] != seat_state::floor) {
-								adjacent.push_back(state[i2][j2]);
-								break;
-							}
-
-							i2 += di;
-							j2 += dj;
-						}
-					} else {
-						adjacent.push_back(state[i][j]);
-					}
+template<typename Shape>
+class stencil {
+public:
+	explicit stencil(const seat_map& padded) {
+		for (std::size_t k = 0; k < Shape::directions.size(); k++) {
+			offsets[k] = Shape::directions[k][0] * static_cast<long>(padded.columns) + Shape::directions[k][1];
+		}
+	}
+
+	std::size_t count(const seat_state* cells, std::size_t i) const {
+		std::size_t occupied = 0;
+
+		for (long offset : offsets) {
+			occupied += cells[static_cast<long>(i) + offset] == seat_state::occupied;
+		}
+
+		return occupied;
+	}
+
+private:
+	std::array<long, Shape::directions.size()> offsets;
+};
+
+/** Counts the occupied first seats seen in the directions of Shape, gathered from precomputed neighbor lists.
+ */
+template<typename Shape>
+class line_of_sight {
+public:
+	explicit line_of_sight(const seat_map& padded) : neighbors(find_neighbors<Shape>(padded, true)) {}
+
+	std::size_t count(const seat_state* cells, std::size_t i) const {
+		std::size_t occupied = 0;
+
+		for (std::uint32_t k = neighbors.offsets[i]; k < neighbors.offsets[i + 1]; k++) {
+			occupied += cells[neighbors.neighbors[k]] == seat_state::occupied;
+		}
+
+		return occupied;
+	}
+
+private:
+	neighbor_list neighbors;
+};
+
+/** Seat rules with one byte per cell, specialized at compile time on how neighbors are counted and on the rule.
+ * The grid gets a border of floor, so neighborhoods never check bounds. Steps read buffer s % 2 and write the other
+ * one, in row bands so a thread_team can share a step.
+ */
+template<typename Neighborhood, typename Rule>
+class seat_automaton {
+public:
+	seat_automaton(const seat_map& map, thread_team& team)
+		: rows(map.rows),
+		columns(map.columns),
+		stride(map.columns + 2),
+		steps(0),
+		neighborhood(pad(map)),
+		buffers { grid((map.rows + 2) * stride), grid((map.rows + 2) * stride) } {
+		// each thread first touches the rows it will step
+		team.run([&](std::size_t thread) {
+			auto [begin, end] = team.band(thread, rows + 2);
+
+			for (std::size_t r = begin; r < end; r++) {
+				for (std::size_t c = 0; c < stride; c++) {
+					bool inside = r > 0 && r <= rows && c > 0 && c <= columns;
+					seat_state state = inside ? map.cells[(r - 1) * columns + c - 1] : seat_state::floor;
+					buffers[0][r * stride + c] = state;
+					buffers[1][r * stride + c] = state;
 				}
 			}
+		});
+	}
+
+	std::size_t height() const {
+		return rows;
+	}
+
+	// one step of Rule
+	step_delta step() {
+		return step_rows(0, rows, steps++);
+	}
+
+	// xor of the keys of the occupied cells
+	std::uint64_t hash() const {
+		std::uint64_t hash = 0;
+
+		for (std::size_t i = 0; i < buffers[steps % 2].size(); i++) {
+			hash ^= buffers[steps % 2][i] == seat_state::occupied ? zobrist_key(i) : 0;
 		}
 
-		return adjacent;
-	};
+		return hash;
+	}
+
+	// counts steps run through step_rows by all threads
+	void advance(std::size_t count) {
+		steps += count;
+	}
+
+	/** Rows [begin, end) of step s (counted from construction), reading buffer s % 2 and writing the other one.
+	 * Returns the step_delta of those rows.
+	 */
+	step_delta step_rows(std::size_t begin, std::size_t end, std::size_t s) {
+		const seat_state* current = buffers[s % 2].data();
+		seat_state* next = buffers[(s + 1) % 2].data();
+		bool hasChanges = false;
+		std::uint64_t hash = 0;
+
+		for (std::size_t r = begin + 1; r <= end; r++) {
+			for (std::size_t i = r * stride + 1; i <= r * stride + columns; i++) {
+				// branchless since seats flip unpredictably
+				seat_state state = current[i];
+				bool flips = Rule::flips(state, neighborhood.count(current, i));
+				hasChanges |= flips;
+				hash ^= zobrist_key(i) & (0 - static_cast<std::uint64_t>(flips));
+				next[i] = static_cast<seat_state>(static_cast<std::uint8_t>(state) ^ (flips * flip_mask));
+			}
+		}
+
+		return { hasChanges, hash };
+	}
+
+	long count_occupied() const {
+		return std::count(buffers[steps % 2].begin(), buffers[steps % 2].end(), seat_state::occupied);
+	}
+
+	grid cells() const {
+		grid cells(rows * columns);
+
+		for (std::size_t r = 0; r < rows; r++) {
+			std::copy_n(buffers[steps % 2].begin() + (r + 1) * stride + 1, columns, cells.begin() + r * columns);
+		}
+
+		return cells;
+	}
 
-	for (long i = 0; i < static_cast<long>(state.size()); i++) {
-		for (long j = 0; j < static_cast<long>(state[i].size()); j++) {
-			if (state[i][j] == seat_state::empty) {
-				// Rule 1
-				auto adjacent = getAdjacent(i, j);
+private:
+	std::size_t rows;
+	std::size_t columns;
+	std::size_t stride;
+	std::size_t steps;
+	Neighborhood neighborhood;
+	std::array<grid, 2> buffers;
 
-				if (std::count(adjacent.begin(), adjacent.end(), seat_state::occupied) == 0) {
-					newState[i][j] = seat_state::occupied;
-					hasChanges = true;
+	static seat_map pad(const seat_map& map) {
+		seat_map padded { map.rows + 2, map.columns + 2, grid((map.rows + 2) * (map.columns + 2), seat_state::floor) };
+
+		for (std::size_t r = 0; r < map.rows; r++) {
+			std::copy_n(map.cells.begin() + r * map.columns, map.columns, padded.cells.begin() + (r + 1) * padded.columns + 1);
+		}
+
+		return padded;
+	}
+};
+
+// part 1 runs on bit_automaton, which packs the same rule as seat_automaton<stencil<moore>, seating_rule<4>> into words
+using part2_automaton = seat_automaton<line_of_sight<moore>, seating_rule<5>>;
+
+// the byte-per-cell reference for part 1, and a von Neumann neighborhood, are kept compiling here
+template class seat_automaton<stencil<moore>, seating_rule<4>>;
+template class seat_automaton<stencil<von_neumann>, seating_rule<3>>;
+
+static long part1(const seat_map& map, thread_team& team);
+static long part2(const seat_map& map, thread_team& team);
+template<typename Automaton>
+static long settle(const seat_map& map, thread_team& team, int part);
+
+int main() {
+	auto stream = open_dataset("data/problem-11.txt");
+	seat_map map { 0, 0, {} };
+	std::string line;
+
+	while (stream >> line) {
+		if (map.rows > 0 && line.size() != map.columns) {
+			throw std::runtime_error("ragged row: " + line);
+		}
+
+		for (char ch : line) {
+			map.cells.push_back(static_cast<seat_state>(ch));
+		}
+
+		map.columns = line.size();
+		map.rows += 1;
+	}
+
+	thread_team team(std::thread::hardware_concurrency());
+	std::cout << "Part 1 Solution: " << part1(map, team) << "\n";
+	std::cout << "Part 2 Solution: " << part2(map, team) << "\n";
+	return 0;
+}
+
+/** Simulates the state until there are no changes and yields the number of occupied seats.
+ * Time complexity: O(mn / w) [where m = # of simulations, w = 64]
+ * Space complexity: O(n / w)
+*/
+long part1(const seat_map& map, thread_team& team) {
+	return settle<bit_automaton>(map, team, 1);
+}
+
+/** Simulates the state until there are no changes and yields the number of occupied seats.
+ * Time complexity: O(mn) [where m = # of simulations]
+ * Space complexity: O(n)
+*/
+long part2(const seat_map& map, thread_team& team) {
+	return settle<part2_automaton>(map, team, 2);
+}
+
+/** Steps an Automaton on every thread of team until its state repeats, and counts the occupied seats once it
+ * settles. Throws the No Solution error of part if the state cycles instead.
+ * Time complexity: O(m * s) [m = # of simulations, s = cost of one step]
+ * Space complexity: O(n)
+ */
+template<typename Automaton>
+long settle(const seat_map& map, thread_team& team, int part) {
+	Automaton automaton(map, team);
+
+	auto [steps, period] = team.run_until_repeat(automaton.hash(), [&](std::size_t thread, std::size_t s) {
+		auto [begin, end] = team.band(thread, automaton.height());
+		return automaton.step_rows(begin, end, s);
+	});
+
+	if (period != 1) {
+		// the seats keep cycling and never settle
+		throw std::runtime_error("Part " + std::to_string(part) + ": No Solution!");
+	}
+
+	automaton.advance(steps);
+	return automaton.count_occupied();
+}
+
+/** Finds the seats next to each seat in the directions of Shape, or the first seat in each direction if lineOfSight.
+ * Seeing is symmetric, so only the directions pointing back in row-major order are searched. The nearest seat in
+ * such a direction is either the next cell or, through floor, the nearest seat of that cell, which is already known.
+ * Time complexity: O(n)
+ * Space complexity: O(n)
+ */
+template<typename Shape>
+neighbor_list find_neighbors(const seat_map& map, bool lineOfSight) {
+	constexpr std::uint32_t none = static_cast<std::uint32_t>(-1);
+	std::size_t size = map.cells.size();
+	std::vector<std::array<std::uint32_t, 2>> edges;
+	std::vector<std::uint32_t> nearest(size, none);
+
+	if (size >= none) {
+		throw std::runtime_error("seat map too large");
+	}
+
+	for (const auto& [dr, dc] : Shape::directions) {
+		if (dr > 0 || (dr == 0 && dc > 0)) {
+			continue;
+		}
+
+		for (std::size_t r = 0; r < map.rows; r++) {
+			for (std::size_t c = 0; c < map.columns; c++) {
+				long row = static_cast<long>(r) + dr;
+				long column = static_cast<long>(c) + dc;
+				std::size_t i = r * map.columns + c;
+
+				if (row < 0 || column < 0 || column >= static_cast<long>(map.columns)) {
+					nearest[i] = none;
+					continue;
 				}
-			} else if (state[i][j] == seat_state::occupied) {
-				// Rule 2
-				auto adjacent = getAdjacent(i, j);
 
-				if (std::count(adjacent.begin(), adjacent.end(), seat_state::occupied) >= 5) {
-					newState[i][j] = seat_state::empty;
-					hasChanges = true;
+				std::size_t j = row * map.columns + column;
+				nearest[i] = map.cells[j] != seat_state::floor ? j : lineOfSight ? nearest[j] : none;
+
+				if (map.cells[i] != seat_state::floor && nearest[i] != none) {
+					edges.push_back({ static_cast<std::uint32_t>(i), nearest[i] });
 				}
 			}
 		}
 	}
 
-	return { hasChanges, newState };
+	neighbor_list list { std::vector<std::uint32_t>(size + 1, 0), std::vector<std::uint32_t>(2 * edges.size()) };
+
+	for (const auto& [from, to] : edges) {
+		list.offsets[from + 1] += 1;
+		list.offsets[to + 1] += 1;
+	}
+
+	for (std::size_t i = 0; i < size; i++) {
+		list.offsets[i + 1] += list.offsets[i];
+	}
+
+	std::vector<std::uint32_t> fill(list.offsets.begin(), list.offsets.end() - 1);
+
+	for (const auto& [from, to] : edges) {
+		list.neighbors[fill[from]++] = to;
+		list.neighbors[fill[to]++] = from;
+	}
+
+	return list;
 }
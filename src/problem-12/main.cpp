@@ -1,6 +1,10 @@
+#include <algorithm>
 #include <cmath>
+#include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #include "dataset.hpp"
 
@@ -11,8 +15,131 @@ struct command {
 
 using input = std::vector<command>;
 
+// x + yi, a quarter turn left is a product with i and a quarter turn right a product with -i
+struct gaussian {
+	long x;
+	long y;
+
+	friend gaussian operator+(const gaussian& left, const gaussian& right) {
+		return { left.x + right.x, left.y + right.y };
+	}
+
+	friend gaussian operator*(const gaussian& left, const gaussian& right) {
+		return { left.x * right.x - left.y * right.y, left.x * right.y + left.y * right.x };
+	}
+};
+
+// the ship as its position and the vector F moves it along: the heading in part 1, the waypoint in part 2
+struct ship {
+	gaussian position;
+	gaussian vector;
+};
+
+/** Affine map of a ship: (position, vector) -> (position + scale * vector + shift, turn * vector + offset).
+ * As 2x2 integer matrices, turn is an exact quarter-turn rotation and scale a sum of scaled rotations.
+ * Maps of this form are closed under composition, so any run of commands compiles into one of them.
+ */
+struct ship_transform {
+	gaussian scale;
+	gaussian shift;
+	gaussian turn;
+	gaussian offset;
+
+	static ship_transform identity() {
+		return { { 0, 0 }, { 0, 0 }, { 1, 0 }, { 0, 0 } };
+	}
+
+	// first, then second
+	friend ship_transform then(const ship_transform& first, const ship_transform& second) {
+		return {
+			first.scale + second.scale * first.turn,
+			first.shift + second.scale * first.offset + second.shift,
+			second.turn * first.turn,
+			second.turn * first.offset + second.offset,
+		};
+	}
+
+	ship operator()(const ship& ship) const {
+		return { ship.position + scale * ship.vector + shift, turn * ship.vector + offset };
+	}
+};
+
+// what N, S, E and W move: the ship itself in part 1, the waypoint in part 2
+enum class navigation { heading, waypoint };
+
+static void append(ship_transform& transform, const command& cmd, navigation mode);
+
+/** Ship positions after any prefix of the commands, by a segment tree over the compiled transforms.
+ * Every node holds the composition of its range in command order, so a prefix is O(log n) node compositions
+ * and replacing one command recomposes its O(log n) ancestors.
+ */
+class route_index {
+public:
+	route_index(const input& input, navigation mode, ship start) : leaves(1), mode(mode), start(start) {
+		while (leaves < input.size()) {
+			leaves *= 2;
+		}
+
+		nodes.assign(2 * leaves, ship_transform::identity());
+
+		for (std::size_t i = 0; i < input.size(); i++) {
+			append(nodes[leaves + i], input[i], mode);
+		}
+
+		for (std::size_t node = leaves - 1; node > 0; node--) {
+			nodes[node] = then(nodes[2 * node], nodes[2 * node + 1]);
+		}
+
+		size = input.size();
+	}
+
+	// the ship after the first k commands
+	ship after(std::size_t k) const {
+		if (k > size) {
+			throw std::out_of_range("command index out of range: " + std::to_string(k));
+		}
+
+		ship_transform left = ship_transform::identity();
+		ship_transform right = ship_transform::identity();
+
+		for (std::size_t low = leaves, high = leaves + k; low < high; low /= 2, high /= 2) {
+			if (low & 1) {
+				left = then(left, nodes[low++]);
+			}
+
+			if (high & 1) {
+				right = then(nodes[--high], right);
+			}
+		}
+
+		return then(left, right)(start);
+	}
+
+	void replace(std::size_t i, const command& cmd) {
+		if (i >= size) {
+			throw std::out_of_range("command index out of range: " + std::to_string(i));
+		}
+
+		std::size_t node = leaves + i;
+		nodes[node] = ship_transform::identity();
+		append(nodes[node], cmd, mode);
+
+		for (node /= 2; node > 0; node /= 2) {
+			nodes[node] = then(nodes[2 * node], nodes[2 * node + 1]);
+		}
+	}
+
+private:
+	std::size_t leaves;
+	std::size_t size;
+	navigation mode;
+	ship start;
+	std::vector<ship_transform> nodes;
+};
+
 static long part1(const input& input);
 static long part2(const input& input);
+static ship_transform compose(const input& input, navigation mode);
 
 int main() {
 	auto stream = open_dataset("data/problem-12.txt");
@@ -31,81 +158,109 @@ int main() {
 }
 
 /** Calculate the manhattan distance between ship's final location.
- * Time complexity: O(n)
- * Space complexity: O(1)
+ * Time complexity: O(n / t + t) [t = number of threads]
+ * Space complexity: O(t)
 */
 long part1(const input& input) {
-	long x = 0;
-	long y = 0;
-	long dx = 1;
-	long dy = 0;
-
-	for (const command& cmd : input) {
-		switch (cmd.direction) {
-			case 'N': y += cmd.count; break;
-			case 'S': y -= cmd.count; break;
-			case 'E': x += cmd.count; break;
-			case 'W': x -= cmd.count; break;
-			case 'F': x += cmd.count * dx; y += cmd.count * dy; break;
-			default: { // L R
-				long k = cmd.count;
-
-				for (; k > 0; k -= 90) {
-					long temp = dx;
-
-					if (cmd.direction == 'L') {
-						// (dx + dyi)i = -dy + dxi
-						dx = -dy;
-						dy = temp;
-					} else {
-						// (dx + dyi)-i = dy - dxi
-						dx = dy;
-						dy = -temp;
-					}
-				}
-			} break;
-		}
-	}
-
-	return std::abs(x) + std::abs(y);
+	ship ship = compose(input, navigation::heading)({ { 0, 0 }, { 1, 0 } });
+	return std::abs(ship.position.x) + std::abs(ship.position.y);
 }
 
 /** Calculate the manhattan distance between ship's final location.
- * Time complexity: O(n)
- * Space complexity: O(1)
+ * Time complexity: O(n / t + t) [t = number of threads]
+ * Space complexity: O(t)
 */
 long part2(const input& input) {
-	long x = 0;
-	long y = 0;
-	long dx = 10;
-	long dy = 1;
-
-	for (const command& cmd : input) {
-		switch (cmd.direction) {
-			case 'N': dy += cmd.count; break;
-			case 'S': dy -= cmd.count; break;
-			case 'E': dx += cmd.count; break;
-			case 'W': dx -= cmd.count; break;
-			case 'F': x += cmd.count * dx; y += cmd.count * dy; break;
-			default: { // L R
-				long k = cmd.count;
-
-				for (; k > 0; k -= 90) {
-					long temp = dx;
-
-					if (cmd.direction == 'L') {
-						// (dx + dyi)i = -dy + dxi
-						dx = -dy;
-						dy = temp;
-					} else {
-						// (dx + dyi)-i = dy - dxi
-						dx = dy;
-						dy = -temp;
-					}
-				}
-			} break;
+	ship ship = compose(input, navigation::waypoint)({ { 0, 0 }, { 10, 1 } });
+	return std::abs(ship.position.x) + std::abs(ship.position.y);
+}
+
+/** Composes one command after transform, in place of then(transform, compiled command).
+ * Time complexity: O(1)
+ * Space complexity: O(1)
+ */
+void append(ship_transform& transform, const command& cmd, navigation mode) {
+	gaussian& move = mode == navigation::heading ? transform.shift : transform.offset;
+
+	switch (cmd.direction) {
+		case 'N': move.y += cmd.count; break;
+		case 'S': move.y -= cmd.count; break;
+		case 'E': move.x += cmd.count; break;
+		case 'W': move.x -= cmd.count; break;
+		case 'F': {
+			gaussian count { cmd.count, 0 };
+			transform.scale = transform.scale + count * transform.turn;
+			transform.shift = transform.shift + count * transform.offset;
+		} break;
+		case 'L':
+		case 'R': {
+			if (cmd.count % 90 != 0) {
+				throw std::invalid_argument("turn is not a multiple of 90 degrees: " + std::to_string(cmd.count));
+			}
+
+			// i^quarters turns left, so a right turn is 4 - quarters left turns
+			static const gaussian quarterTurns[] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+			long quarters = ((cmd.count / 90) % 4 + 4) % 4;
+			const gaussian& turn = quarterTurns[cmd.direction == 'L' ? quarters : (4 - quarters) % 4];
+			transform.turn = turn * transform.turn;
+			transform.offset = turn * transform.offset;
+		} break;
+		default: throw std::invalid_argument(std::string("unknown command: ") + cmd.direction);
+	}
+}
+
+/** Composes every command into one transform, in contiguous chunks on separate threads.
+ * Composition is associative, so the per-chunk transforms fold in order into the same result as a sequential scan.
+ * A bad command throws out of compose on the calling thread, the error of the earliest failing chunk wins.
+ * Time complexity: O(n / t + t) [t = number of threads]
+ * Space complexity: O(t)
+ */
+ship_transform compose(const input& input, navigation mode) {
+	// below this many commands per thread, starting the thread costs more than the chunk
+	constexpr std::size_t minimumChunk = 1 << 16;
+	std::size_t threads = std::clamp<std::size_t>(input.size() / minimumChunk, 1, std::max(std::thread::hardware_concurrency(), 1U));
+	std::vector<ship_transform> partials(threads, ship_transform::identity());
+	std::vector<std::exception_ptr> errors(threads);
+	std::vector<std::thread> workers;
+
+	// an exception escaping a thread would terminate the process, so it is carried back to the join
+	auto reduce = [&](std::size_t thread) {
+		std::size_t begin = input.size() * thread / threads;
+		std::size_t end = input.size() * (thread + 1) / threads;
+		ship_transform partial = ship_transform::identity();
+
+		try {
+			for (std::size_t i = begin; i < end; i++) {
+				append(partial, input[i], mode);
+			}
+		} catch (...) {
+			errors[thread] = std::current_exception();
 		}
+
+		partials[thread] = partial;
+	};
+
+	for (std::size_t thread = 1; thread < threads; thread++) {
+		workers.emplace_back(reduce, thread);
+	}
+
+	reduce(0);
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	for (const auto& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	ship_transform transform = ship_transform::identity();
+
+	for (const auto& partial : partials) {
+		transform = then(transform, partial);
 	}
 
-	return std::abs(x) + std::abs(y);
+	return transform;
 }
@@ -1,16 +1,33 @@
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
+#include "big_unsigned.hpp"
 #include "dataset.hpp"
+#include "int128.hpp"
 
 struct input {
 	long timestamp;
 	std::vector<long> active;
 };
 
+// every t with t % modulus == residue, for a modulus of 1 that is every t
+template<typename Number>
+struct congruence {
+	Number residue;
+	Number modulus;
+};
+
 static long part1(const input& input);
-static long part2(const input& input);
+static big_unsigned part2(const input& input);
+template<typename Number>
+static bool combine(congruence<Number>& system, std::uint64_t residue, std::uint64_t modulus);
+static std::uint64_t inverse(std::uint64_t value, std::uint64_t modulus);
+static big_unsigned promote(uint128 value);
 
 int main() {
 	auto stream = open_dataset("data/problem-13.txt");
@@ -37,61 +54,149 @@ int main() {
 }
 
 /** The product of the first active bus ID and the time delta.
- * Time complexity: O(n^2)
+ * Bus b next departs (-timestamp) mod b minutes after the timestamp.
+ * Time complexity: O(n)
  * Space complexity: O(1)
 */
 long part1(const input& input) {
-	long time = input.timestamp;
+	long best = -1;
+	long wait = 0;
 
-	while (true) {
-		for (long bus : input.active) {
-			if (bus >= 0 && time % bus == 0) {
-				return bus * (time - input.timestamp);
-			}
+	for (long bus : input.active) {
+		if (bus <= 0) {
+			continue;
 		}
 
-		time += 1;
+		long delay = ((-input.timestamp) % bus + bus) % bus;
+
+		if (best == -1 || delay < wait) {
+			best = bus;
+			wait = delay;
+		}
 	}
+
+	if (best == -1) {
+		throw std::runtime_error("Part 1: No Solution!");
+	}
+
+	return best * wait;
 }
 
 /** The first timestamp such that each bus is active i minutes after the timestamp.
- * Time complexity: O(mn^2) ??
- * Space complexity: O(1)
+ * Bus b at index i asks for t = -i (mod b), and the congruences combine one by one (Chinese remainder theorem).
+ * The system stays in 128-bit arithmetic while the combined modulus fits and moves to big_unsigned once it does not.
+ * Time complexity: O(n * (w + log m)) [w = words in the combined modulus, m = largest bus ID]
+ * Space complexity: O(w)
 */
-long part2(const input& input) {
-	long time = input.active[0];
-	long step = input.active[0];
-	std::size_t current = 1;
+big_unsigned part2(const input& input) {
+	congruence<uint128> small { 0, 1 };
+	congruence<big_unsigned> big { 0, 1 };
+	bool promoted = false;
 
-	while (true) {
-		bool valid = true;
+	for (std::size_t i = 0; i < input.active.size(); i++) {
+		long bus = input.active[i];
 
-		// skip x's
-		while (current < input.active.size() && input.active[current] == -1) {
-			current += 1;
+		if (bus <= 0) {
+			continue;
 		}
 
-		// check if current timestamp is valid
-		for (std::size_t idx = 0; idx <= current; idx++) {
-			long bus = input.active[idx];
+		auto modulus = static_cast<std::uint64_t>(bus);
+		std::uint64_t residue = (modulus - i % modulus) % modulus;
+
+		if (!promoted && !combine(small, residue, modulus)) {
+			big = { promote(small.residue), promote(small.modulus) };
+			promoted = true;
+		}
 
-			if (bus >= 0 && (time + idx) % bus != 0) {
-				valid = false;
-				break;
-			}
+		if (promoted) {
+			combine(big, residue, modulus);
 		}
+	}
 
-		if (valid) {
-			if (current == input.active.size() - 1) {
-				return time;
-			}
+	return promoted ? big.residue : promote(small.residue);
+}
+
+/** Narrows system to also satisfy t = residue (mod modulus), for moduli that need not be coprime.
+ * With g = gcd(M, modulus), t = R + M * k works iff g divides residue - R, and then k is fixed modulo modulus / g,
+ * so the combined modulus is lcm(M, modulus) = M * (modulus / g).
+ * Returns false and leaves system unchanged if Number cannot hold the combined modulus; throws if there is no such t.
+ * Time complexity: O(w + log m) [w = words in Number]
+ * Space complexity: O(w)
+ */
+template<typename Number>
+bool combine(congruence<Number>& system, std::uint64_t residue, std::uint64_t modulus) {
+	std::uint64_t systemModulus;
+	std::uint64_t systemResidue;
+
+	if constexpr (std::is_same_v<Number, big_unsigned>) {
+		systemModulus = system.modulus.remainder(modulus);
+		systemResidue = system.residue.remainder(modulus);
+	} else {
+		systemModulus = static_cast<std::uint64_t>(system.modulus % modulus);
+		systemResidue = static_cast<std::uint64_t>(system.residue % modulus);
+	}
 
-			step *= input.active[current];
-			current += 1;
+	// gcd(M, modulus) = gcd(M mod modulus, modulus)
+	std::uint64_t gcd = std::gcd(systemModulus, modulus);
+	std::uint64_t difference = (residue + modulus - systemResidue) % modulus;
+
+	if (difference % gcd != 0) {
+		throw std::runtime_error("Part 2: No Solution!");
+	}
+
+	// M * k = difference (mod modulus) reduces to (M / g) * k = difference / g (mod modulus / g)
+	std::uint64_t step = modulus / gcd;
+	std::uint64_t k = static_cast<std::uint64_t>(
+		static_cast<uint128>(difference / gcd) * inverse(systemModulus / gcd % step, step) % step);
+
+	if constexpr (std::is_same_v<Number, big_unsigned>) {
+		system.residue += system.modulus * big_unsigned(k);
+		system.modulus *= big_unsigned(step);
+	} else {
+		Number combined;
+
+		if (__builtin_mul_overflow(system.modulus, static_cast<Number>(step), &combined)) {
+			return false;
 		}
 
-		time += step;
+		// R < M and k < step, so R + M * k < M * step and cannot overflow either
+		system.residue += system.modulus * k;
+		system.modulus = combined;
 	}
 
-	return -1;
+	return true;
+}
+
+/** The multiplicative inverse of value modulo modulus, for a value coprime to modulus.
+ * Time complexity: O(log m)
+ * Space complexity: O(1)
+ */
+std::uint64_t inverse(std::uint64_t value, std::uint64_t modulus) {
+	// extended Euclid, keeping only the coefficients of value
+	int128 previous = 0;
+	int128 current = 1;
+	std::uint64_t a = modulus;
+	std::uint64_t b = value % modulus;
+
+	while (b != 0) {
+		std::uint64_t quotient = a / b;
+		int128 next = previous - static_cast<int128>(quotient) * current;
+		std::uint64_t rest = a - quotient * b;
+		previous = current;
+		current = next;
+		a = b;
+		b = rest;
+	}
+
+	return static_cast<std::uint64_t>(previous < 0 ? previous + modulus : previous) % modulus;
+}
+
+/** Widens a 128-bit value to a big_unsigned.
+ * Time complexity: O(1)
+ * Space complexity: O(1)
+ */
+big_unsigned promote(uint128 value) {
+	big_unsigned high(static_cast<std::uint64_t>(value >> 64));
+	big_unsigned shift(std::uint64_t(1) << 32);
+	return high * shift * shift + big_unsigned(static_cast<std::uint64_t>(value));
 }
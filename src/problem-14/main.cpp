@@ -1,9 +1,10 @@
+#include <algorithm>
 #include <iostream>
 #include <numeric>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 #include "dataset.hpp"
+#include "flat_hash_map.hpp"
 
 struct entry {
 	unsigned long or_mask;
@@ -68,7 +69,14 @@ int main() {
  * Space complexity: O(n)
 */
 long part1(const state& state) {
-	std::unordered_map<long, long> memory;
+	flat_hash_map<long, long> memory;
+	std::size_t writes = 0;
+
+	for (const auto& entry : state.entries) {
+		writes += entry.writes.size();
+	}
+
+	memory.reserve(writes);
 
 	for (const auto& entry : state.entries) {
 		for (const auto& write : entry.writes) {
@@ -87,10 +95,20 @@ long part1(const state& state) {
 */
 #include <bitset>
 long part2(const state& state) {
-	std::unordered_map<long, long> memory;
+	constexpr std::size_t maxReserve = 1 << 20;
+	flat_hash_map<long, long> memory;
 	std::vector<long> floating;
+	std::size_t writes = 0;
 	floating.reserve(36);
 
+	// every write covers 2^k addresses for k floating bits, an upper bound on the distinct ones
+	// repeated writes with many floating bits overestimate wildly, so past maxReserve the table grows as needed
+	for (const auto& entry : state.entries) {
+		writes = std::min(maxReserve, writes + (entry.writes.size() << __builtin_popcountl(entry.and_mask)));
+	}
+
+	memory.reserve(writes);
+
 	for (const auto& entry : state.entries) {
 		for (std::size_t i = 0; i < 36; i++) {
 			// entry.and_masks comprises of all floating bits
@@ -1,8 +1,7 @@
 #include <iostream>
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include "dataset.hpp"
+#include "flat_hash_map.hpp"
 
 using input = std::vector<long>;
 
@@ -42,30 +41,27 @@ long part2(const input& input) {
 }
 
 /** Simulates n steps of the game.
+ * Only the turn each number was last spoken on is kept, the number just spoken goes in after its age is read.
  * Time complexity: O(n)
  * Space complexity: O(n)
  */
 static long simulate(const input& input, long n) {
-	long lastSpoken;
-	std::unordered_map<long, std::vector<long>> seen;
+	if (n <= static_cast<long>(input.size())) {
+		return input[n - 1];
+	}
+
+	flat_hash_map<long, long> lastTurn;
+	long lastSpoken = input.back();
 
-	for (long turn = 0; turn < static_cast<long>(input.size()); turn++) {
-		lastSpoken = input[turn];
-		seen[lastSpoken].push_back(turn);
+	for (long turn = 0; turn + 1 < static_cast<long>(input.size()); turn++) {
+		lastTurn[input[turn]] = turn;
 	}
 
 	for (long turn = input.size(); turn < n; turn++) {
-		long value;
-		bool seenLast = seen[lastSpoken].size() > 1;
-
-		if (seenLast) {
-			const auto& history = seen[lastSpoken];
-			value = history[history.size() - 1] - history[history.size() - 2];
-		} else {
-			value = 0;
-		}
+		auto [iter, first] = lastTurn.emplace(lastSpoken, turn - 1);
+		long value = first ? 0 : turn - 1 - iter->second;
 
-		seen[value].push_back(turn);
+		iter->second = turn - 1;
 		lastSpoken = value;
 	}
 
@@ -1,182 +1,401 @@
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <numeric>
+#include <sstream>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 #include "dataset.hpp"
 
 enum class field { byr, iyr, eyr, hgt, hcl, ecl, pid, cid };
-using input_entry = std::unordered_map<field, std::string>;
+
+constexpr std::size_t field_count = 8;
+
+// fields are views into the dataset buffer, present has bit i set if field i was given
+struct input_entry {
+	std::array<std::string_view, field_count> fields;
+	std::uint8_t present;
+};
+
 using input = std::vector<input_entry>;
 
-static std::unordered_map<std::string, field> mapping({
-	{ "byr", field::byr },
-	{ "iyr", field::iyr },
-	{ "eyr", field::eyr },
-	{ "hgt", field::hgt },
-	{ "hcl", field::hcl },
-	{ "ecl", field::ecl },
-	{ "pid", field::pid },
-	{ "cid", field::cid }
+// ordered by evaluation cost
+enum class rule_kind { any, pattern, enumeration, number };
+
+// unit is packed, unit_length is 0 for plain integers
+struct number_range {
+	std::uint64_t unit;
+	std::size_t unit_length;
+	long min;
+	long max;
+};
+
+struct rule {
+	rule_kind kind;
+	std::vector<number_range> ranges; // number
+	std::string prefix; // pattern
+	std::size_t length; // pattern
+	std::uint8_t char_class; // pattern
+	std::vector<std::uint64_t> values; // enumeration (packed)
+};
+
+// order lists the fields cheapest rule first
+struct schema {
+	std::array<rule, field_count> rules;
+	std::array<std::size_t, field_count> order;
+	std::uint8_t required;
+};
+
+static constexpr std::array<std::string_view, field_count> mapping({
+	"byr", "iyr", "eyr", "hgt", "hcl", "ecl", "pid", "cid"
 });
 
-static std::size_t part1(const input& input);
-static std::size_t part2(const input& input);
-static bool validate_int(const std::string& value, long min, long max);
+enum char_class : std::uint8_t { digit = 1, hex_digit = 2 };
+
+static constexpr auto char_classes = []() {
+	std::array<std::uint8_t, 256> table {};
+
+	for (char ch = '0'; ch <= '9'; ch++) {
+		table[static_cast<unsigned char>(ch)] = char_class::digit | char_class::hex_digit;
+	}
+
+	for (char ch = 'a'; ch <= 'f'; ch++) {
+		table[static_cast<unsigned char>(ch)] = char_class::hex_digit;
+	}
+
+	return table;
+}();
+
+static std::size_t part1(const input& input, const schema& schema);
+static std::size_t part2(const input& input, const schema& schema);
+static field parse_field(std::string_view key);
+static schema load_schema(const std::string& path);
+static bool parse_number(std::string_view value, long& result);
+static bool pack(std::string_view value, std::uint64_t& result);
 
 int main() {
-	auto stream = open_dataset("data/problem-4.txt");
+	auto schema = load_schema("data/problem-4-rules.txt");
+	std::string buffer = read_dataset("data/problem-4.txt");
+	std::string_view data(buffer);
 	input input;
-	input_entry entry;
-	std::string line;
+	input_entry entry {};
 
-	while (stream >> line) {
+	for (std::size_t i = 0; i < data.size(); i++) {
 		// field:value
-		std::size_t k = line.find(':');
-		auto key = line.substr(0, k);
-		auto value = line.substr(k + 1);
-		entry[mapping.at(key)] = value;
-
-		if (stream.peek() == '\n') {
-			stream.get();
-
-			// new passport entry
-			if (stream.peek() == '\n' || stream.peek() == std::ifstream::traits_type::eof()) {
-				stream.get();
-				input.push_back(std::move(entry));
-				entry.clear();
-			}
+		std::size_t j = i;
+
+		while (j < data.size() && data[j] != ' ' && data[j] != '\n') {
+			j++;
 		}
-	}
 
-	std::cout << "Part 1 Solution: " << part1(input) << "\n";
-	std::cout << "Part 2 Solution: " << part2(input) << "\n";
-	return 0;
-}
+		auto token = data.substr(i, j - i);
+		std::size_t k = token.find(':');
 
-static std::unordered_map<field, bool(*)(const input_entry& entry)> validators({
-	{
-		field::byr,
-		[](const input_entry& entry) {
-			return validate_int(entry.at(field::byr), 1920, 2002);
-		}
-	},
-	{
-		field::iyr,
-		[](const input_entry& entry) {
-			return validate_int(entry.at(field::iyr), 2010, 2020);
+		if (k != std::string_view::npos) {
+			auto key = static_cast<std::size_t>(parse_field(token.substr(0, k)));
+			entry.fields[key] = token.substr(k + 1);
+			entry.present |= 1 << key;
 		}
-	},
-	{
-		field::eyr,
-		[](const input_entry& entry) {
-			return validate_int(entry.at(field::eyr), 2020, 2030);
-		}
-	},
-	{
-		field::hgt,
-		[](const input_entry& entry) {
-			const auto& hgt = entry.at(field::hgt);
-
-			if (hgt.size() >= 3) {
-				auto val = hgt.substr(0, hgt.size() - 2);
-				auto unit = hgt.substr(hgt.size() - 2, 2);
-
-				return unit == "cm"
-					? validate_int(val, 150, 193)
-					: unit == "in"
-					? validate_int(val, 59, 76)
-					: false;
+
+		i = j;
+
+		// new passport entry
+		if (j + 1 >= data.size() || (data[j] == '\n' && data[j + 1] == '\n')) {
+			if (entry.present != 0) {
+				input.push_back(entry);
+				entry = {};
 			}
 
-			return false;
-		}
-	},
-	{
-		field::hcl,
-		[](const input_entry& entry) {
-			const auto& hcl = entry.at(field::hcl);
-
-			// #xxxxxx
-			return hcl.size() == 7
-				&& hcl[0] == '#'
-				&& std::all_of(hcl.begin() + 1, hcl.end(), [](char ch) {
-					return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f');
-				});
-		}
-	},
-	{
-		field::ecl,
-		[](const input_entry& entry) {
-			const auto& ecl = entry.at(field::ecl);
-
-			return ecl == "amb"
-				|| ecl == "blu"
-				|| ecl == "brn"
-				|| ecl == "gry"
-				|| ecl == "grn"
-				|| ecl == "hzl"
-				|| ecl == "oth";
-		}
-	},
-	{
-		field::pid,
-		[](const input_entry& entry) {
-			const auto& pid = entry.at(field::pid);
-
-			// ddddddddd
-			return pid.size() == 9
-				&& std::all_of(pid.begin(), pid.end(), [](char ch) { return ch >= '0' && ch <= '9'; });
+			i += 1;
 		}
-	},
-	{ field::cid, [](const input_entry& entry) { return true; } }
-});
+	}
+
+	std::cout << "Part 1 Solution: " << part1(input, schema) << "\n";
+	std::cout << "Part 2 Solution: " << part2(input, schema) << "\n";
+	return 0;
+}
 
 /** Count passports with all required fields.
  * Time complexity: O(n)
  * Space complexity: O(1)
 */
-std::size_t part1(const input& input) {
-	return std::accumulate(
-		input.begin(),
-		input.end(),
-		static_cast<std::size_t>(0), [](std::size_t acc, const input_entry& entry) {
-			return acc + (
-				std::all_of(mapping.begin(), mapping.end(), [&entry](const auto& pair) {
-					// cid optional
-					return entry.count(pair.second) > 0 || pair.second == field::cid;
-				}) ? 1 : 0
-			);
-		}
-	);
+std::size_t part1(const input& input, const schema& schema) {
+	return std::count_if(input.begin(), input.end(), [&schema](const input_entry& entry) {
+		return (entry.present & schema.required) == schema.required;
+	});
+}
+
+/** Applies check to field f of the selected entries and compacts the selection to those that pass.
+ * An absent field passes (required fields were already filtered on).
+ * Time complexity: O(n)
+ * Space complexity: O(1)
+ */
+template<typename Check>
+static std::size_t apply_rule(const input_entry* entries, std::uint32_t* selection, std::size_t n, std::size_t f, Check check) {
+	std::size_t kept = 0;
+
+	for (std::size_t i = 0; i < n; i++) {
+		const auto& entry = entries[selection[i]];
+		bool absent = ((entry.present >> f) & 1) == 0;
+		selection[kept] = selection[i];
+		kept += absent || check(entry.fields[f]);
+	}
+
+	return kept;
 }
 
 /** Count passports with all required fields with valid values.
  * Time complexity: O(n)
  * Space complexity: O(1)
 */
-std::size_t part2(const input& input) {
-	return std::accumulate(
-		input.begin(),
-		input.end(),
-		static_cast<std::size_t>(0),
-		[](std::size_t acc, const input_entry& entry) {
-			return acc + (
-				std::all_of(mapping.begin(), mapping.end(), [&entry](const auto& pair) {
-					// cid optional
-					return entry.count(pair.second) > 0 ? validators[pair.second](entry) : pair.second == field::cid;
-				}) ? 1 : 0
-			);
+std::size_t part2(const input& input, const schema& schema) {
+	constexpr std::size_t batchSize = 1024;
+	std::array<std::uint32_t, batchSize> selection;
+	std::size_t total = 0;
+
+	for (std::size_t begin = 0; begin < input.size(); begin += batchSize) {
+		const input_entry* entries = input.data() + begin;
+		std::size_t count = std::min(batchSize, input.size() - begin);
+		std::size_t n = 0;
+
+		for (std::size_t i = 0; i < count; i++) {
+			selection[n] = static_cast<std::uint32_t>(i);
+			n += (entries[i].present & schema.required) == schema.required;
+		}
+
+		// one pass per field so the rule kind is resolved once per batch
+		for (std::size_t k = 0; k < field_count && n > 0; k++) {
+			std::size_t f = schema.order[k];
+			const rule& rule = schema.rules[f];
+
+			switch (rule.kind) {
+				case rule_kind::any: break;
+				case rule_kind::number: {
+					n = apply_rule(entries, selection.data(), n, f, [&rule](std::string_view value) {
+						bool ok = false;
+
+						for (const auto& range : rule.ranges) {
+							long number = 0;
+							std::uint64_t unit = 0;
+							bool parsed = value.size() > range.unit_length
+								&& pack(value.substr(value.size() - range.unit_length), unit)
+								&& unit == range.unit
+								&& parse_number(value.substr(0, value.size() - range.unit_length), number);
+							ok |= parsed & (number >= range.min) & (number <= range.max);
+						}
+
+						return ok;
+					});
+				} break;
+				case rule_kind::pattern: {
+					n = apply_rule(entries, selection.data(), n, f, [&rule](std::string_view value) {
+						if (value.size() != rule.prefix.size() + rule.length
+							|| value.compare(0, rule.prefix.size(), rule.prefix) != 0
+						) {
+							return false;
+						}
+
+						std::uint8_t matched = rule.char_class;
+
+						for (char ch : value.substr(rule.prefix.size())) {
+							matched &= char_classes[static_cast<unsigned char>(ch)];
+						}
+
+						return matched != 0;
+					});
+				} break;
+				case rule_kind::enumeration: {
+					n = apply_rule(entries, selection.data(), n, f, [&rule](std::string_view value) {
+						std::uint64_t packed = 0;
+						bool ok = false;
+
+						if (!pack(value, packed)) {
+							return false;
+						}
+
+						for (std::uint64_t candidate : rule.values) {
+							ok |= candidate == packed;
+						}
+
+						return ok;
+					});
+				} break;
+			}
 		}
-	);
+
+		total += n;
+	}
+
+	return total;
+}
+
+/** Returns the field named by key.
+ * Time complexity: O(1)
+ * Space complexity: O(1)
+ */
+field parse_field(std::string_view key) {
+	auto iter = std::find(mapping.begin(), mapping.end(), key);
+
+	if (iter == mapping.end()) {
+		throw std::runtime_error("unknown field: " + std::string(key));
+	}
+
+	return static_cast<field>(iter - mapping.begin());
+}
+
+/** Loads the field validation rules, one field per line.
+ * rule = FIELD "int" LONG LONG
+ *      | FIELD "unit" (WORD LONG LONG)+
+ *      | FIELD "hex" WORD LONG
+ *      | FIELD "digits" LONG
+ *      | FIELD "enum" WORD+
+ *      | FIELD "any"
+ *      | FIELD "optional";
+ */
+schema load_schema(const std::string& path) {
+	auto stream = open_dataset(path);
+	schema schema {};
+	std::string line;
+
+	while (std::getline(stream, line)) {
+		std::istringstream words(line);
+		std::string name, kind;
+
+		if (!(words >> name >> kind)) {
+			continue;
+		}
+
+		auto f = static_cast<std::size_t>(parse_field(name));
+		rule& rule = schema.rules[f];
+		bool malformed = false;
+
+		// true iff every word before was read and nothing follows them
+		auto exhausted = [&words]() {
+			std::string extra;
+			return !words.fail() && !(words >> extra);
+		};
+
+		rule = {};
+		schema.required |= 1 << f;
+
+		if (kind == "int") {
+			number_range range {};
+			words >> range.min >> range.max;
+			rule.kind = rule_kind::number;
+			rule.ranges.push_back(std::move(range));
+			malformed = !exhausted();
+		} else if (kind == "unit") {
+			number_range range {};
+			std::string unit;
+			rule.kind = rule_kind::number;
+
+			// a unit must come with both bounds, a truncated trailing range is an error
+			while (words >> unit) {
+				if (!(words >> range.min >> range.max)) {
+					malformed = true;
+					break;
+				}
+
+				if (!pack(unit, range.unit)) {
+					throw std::runtime_error("unit too long: " + unit);
+				}
+
+				range.unit_length = unit.size();
+				rule.ranges.push_back(range);
+			}
+
+			malformed = malformed || rule.ranges.empty();
+		} else if (kind == "hex" || kind == "digits") {
+			rule.kind = rule_kind::pattern;
+			rule.char_class = kind == "hex" ? char_class::hex_digit : char_class::digit;
+
+			if (kind == "hex") {
+				words >> rule.prefix;
+			}
+
+			words >> rule.length;
+			malformed = !exhausted();
+		} else if (kind == "enum") {
+			std::string value;
+			std::uint64_t packed = 0;
+			rule.kind = rule_kind::enumeration;
+
+			while (words >> value) {
+				if (!pack(value, packed)) {
+					throw std::runtime_error("enum value too long: " + value);
+				}
+
+				rule.values.push_back(packed);
+			}
+
+			malformed = rule.values.empty();
+		} else if (kind == "any" || kind == "optional") {
+			rule.kind = rule_kind::any;
+			malformed = !exhausted();
+
+			if (kind == "optional") {
+				schema.required &= ~(1 << f);
+			}
+		} else {
+			throw std::runtime_error("unknown rule: " + kind);
+		}
+
+		if (malformed) {
+			throw std::runtime_error("malformed rule: " + line);
+		}
+	}
+
+	// cheap rules reject most invalid entries before the expensive ones run
+	std::iota(schema.order.begin(), schema.order.end(), 0);
+	std::stable_sort(schema.order.begin(), schema.order.end(), [&schema](std::size_t left, std::size_t right) {
+		return schema.rules[left].kind < schema.rules[right].kind;
+	});
+
+	return schema;
 }
 
-bool validate_int(const std::string& value, long min, long max) {
-	try {
-		long res = std::stol(value);
-		return res >= min && res <= max;
-	} catch (...) {
+/** Parses a non-empty decimal string with an optional sign without throwing.
+ * Time complexity: O(n)
+ * Space complexity: O(1)
+ */
+bool parse_number(std::string_view value, long& result) {
+	unsigned long number = 0;
+	unsigned long bad = 0;
+	bool negative = !value.empty() && value[0] == '-';
+
+	if (!value.empty() && (value[0] == '-' || value[0] == '+')) {
+		value.remove_prefix(1);
+	}
+
+	if (value.empty() || value.size() > 18) {
 		return false;
 	}
+
+	for (char ch : value) {
+		unsigned long digit = static_cast<unsigned char>(ch) - static_cast<unsigned long>('0');
+		bad |= digit > 9;
+		number = number * 10 + digit;
+	}
+
+	result = negative ? -static_cast<long>(number) : static_cast<long>(number);
+	return bad == 0;
+}
+
+/** Packs a string of at most 8 characters into an integer for comparison.
+ * Time complexity: O(1)
+ * Space complexity: O(1)
+ */
+bool pack(std::string_view value, std::uint64_t& result) {
+	result = 0;
+
+	if (value.size() > sizeof(result)) {
+		return false;
+	}
+
+	std::memcpy(&result, value.data(), value.size());
+	return true;
 }
@@ -1,88 +1,273 @@
-#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <string>
-#include <unordered_set>
+#include <string_view>
 #include <vector>
 #include "dataset.hpp"
 
-struct input_entry {
-	std::size_t id;
-	std::size_t row;
-	std::size_t column;
+/** Bitmap with one summary level per 64x reduction, so first/last set bit are found in O(log64 n).
+ * Bit i of a summary word is set iff word i of the level below is non-zero.
+ */
+class hierarchical_bitmap {
+public:
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	explicit hierarchical_bitmap(std::size_t size) {
+		do {
+			size = (size + 63) / 64;
+			levels.emplace_back(size, 0);
+		} while (size > 1);
+	}
+
+	bool test(std::size_t i) const {
+		return ((levels[0][i / 64] >> (i % 64)) & 1) != 0;
+	}
+
+	void set(std::size_t i) {
+		for (auto& level : levels) {
+			std::uint64_t& word = level[i / 64];
+			bool wasEmpty = word == 0;
+			word |= 1UL << (i % 64);
+			i /= 64;
+
+			if (!wasEmpty) {
+				break;
+			}
+		}
+	}
+
+	void reset(std::size_t i) {
+		for (auto& level : levels) {
+			std::uint64_t& word = level[i / 64];
+			word &= ~(1UL << (i % 64));
+			i /= 64;
+
+			if (word != 0) {
+				break;
+			}
+		}
+	}
+
+	std::size_t find_first() const {
+		if (levels.back()[0] == 0) {
+			return npos;
+		}
+
+		std::size_t i = 0;
+
+		for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+			i = i * 64 + __builtin_ctzll((*level)[i]);
+		}
+
+		return i;
+	}
+
+	std::size_t find_last() const {
+		if (levels.back()[0] == 0) {
+			return npos;
+		}
+
+		std::size_t i = 0;
+
+		for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+			i = i * 64 + (63 - __builtin_clzll((*level)[i]));
+		}
+
+		return i;
+	}
+
+private:
+	std::vector<std::vector<std::uint64_t>> levels;
 };
 
-using input = std::vector<input_entry>;
+/** Live seat occupancy for a plane of 2^rowBits rows and 2^columnBits columns.
+ * free keeps every empty seat whose two neighboring seat IDs are taken, so both queries are a bitmap search.
+ */
+class seat_map {
+public:
+	seat_map(std::size_t rowBits, std::size_t columnBits)
+		: length(rowBits + columnBits),
+		passes(1UL << length, 0),
+		occupied(1UL << length),
+		free(1UL << length) {}
+
+	std::size_t pass_length() const {
+		return length;
+	}
+
+	void insert(std::size_t id) {
+		if (passes.at(id)++ == 0) {
+			occupied.set(id);
+			update_neighbors(id);
+		}
+	}
+
+	void erase(std::size_t id) {
+		if (passes.at(id) > 0 && --passes[id] == 0) {
+			occupied.reset(id);
+			update_neighbors(id);
+		}
+	}
+
+	std::size_t max_seat() const {
+		return occupied.find_last();
+	}
+
+	std::size_t free_seat() const {
+		return free.find_first();
+	}
+
+private:
+	std::size_t length;
+	std::vector<std::uint32_t> passes;
+	hierarchical_bitmap occupied;
+	hierarchical_bitmap free;
+
+	void update_neighbors(std::size_t id) {
+		for (std::size_t seat = id > 0 ? id - 1 : 0; seat <= id + 1 && seat < passes.size(); seat++) {
+			bool isFree = !occupied.test(seat)
+				&& seat > 0 && occupied.test(seat - 1)
+				&& seat + 1 < passes.size() && occupied.test(seat + 1);
+
+			if (isFree) {
+				free.set(seat);
+			} else {
+				free.reset(seat);
+			}
+		}
+	}
+};
 
-static std::size_t part1(const input& input);
-static std::size_t part2(const input& input);
-static std::size_t bsp(const std::string& data, char lowerChar);
+static std::size_t part1(const seat_map& seats);
+static std::size_t part2(const seat_map& seats);
+static std::size_t seat_id(const char* pass, std::size_t length);
+static bool is_pass(std::string_view pass);
 
 int main() {
-	auto stream = open_dataset("data/problem-5.txt");
-	input input;
-	std::string line;
+	std::string buffer = read_dataset("data/problem-5.txt");
+	std::string_view data(buffer);
+	seat_map seats(7, 3);
+	std::size_t length = seats.pass_length();
+
+	auto isSpace = [](char ch) {
+		return ch == '\n' || ch == ' ' || ch == '\r' || ch == '\t';
+	};
+
+	for (std::size_t i = 0;; i += length) {
+		while (i < data.size() && isSpace(data[i])) {
+			i++;
+		}
+
+		if (i == data.size()) {
+			break;
+		}
+
+		// FBFBBFFRLR, then whitespace or the end
+		auto pass = data.substr(i, length);
+		bool valid = pass.size() == length
+			&& (i + length == data.size() || isSpace(data[i + length]))
+			&& is_pass(pass);
+
+		if (!valid) {
+			throw std::runtime_error("malformed boarding pass: " + std::string(pass));
+		}
 
-	while (stream >> line) {
-		input_entry entry;
-		entry.row = bsp(line.substr(0, 7), 'F');
-		entry.column = bsp(line.substr(7), 'L');
-		entry.id = (8 * entry.row) + entry.column;
-		input.push_back(std::move(entry));
+		seats.insert(seat_id(pass.data(), length));
 	}
 
-	std::cout << "Part 1 Solution: " << part1(input) << "\n";
-	std::cout << "Part 2 Solution: " << part2(input) << "\n";
+	std::cout << "Part 1 Solution: " << part1(seats) << "\n";
+	std::cout << "Part 2 Solution: " << part2(seats) << "\n";
 	return 0;
 }
 
 /** Returns the highest seat ID.
- * Time complexity: O(n)
+ * Time complexity: O(log n)
  * Space complexity: O(1)
 */
-std::size_t part1(const input& input) {
-	return std::max_element(input.begin(), input.end(), [](const input_entry& left, const input_entry& right) {
-		return left.id < right.id;
-	})->id;
+std::size_t part1(const seat_map& seats) {
+	std::size_t id = seats.max_seat();
+
+	if (id == hierarchical_bitmap::npos) {
+		throw std::runtime_error("Part 1: No Solution!");
+	}
+
+	return id;
 }
 
-/** Returns an empty seat ID after the first seat ID.
- * Time complexity: O(n log n)
- * Space complexity: O(n)
+/** Returns the empty seat ID whose neighboring seat IDs are both taken.
+ * Time complexity: O(log n)
+ * Space complexity: O(1)
 */
-std::size_t part2(const input& input) {
-	typename ::input sorted(input);
+std::size_t part2(const seat_map& seats) {
+	std::size_t id = seats.free_seat();
 
-	std::sort(sorted.begin(), sorted.end(), [](const auto& left, const auto& right) {
-		return left.id < right.id;
-	});
+	if (id == hierarchical_bitmap::npos) {
+		throw std::runtime_error("Part 2: No Solution!");
+	}
 
-	for (std::size_t i = 1; i < sorted.size(); i++) {
-		if (sorted[i].id != sorted[i - 1].id + 1) {
-			return sorted[i - 1].id + 1;
-		}
+	return id;
+}
+
+/** Decodes a boarding pass into its seat ID, 8 characters at a time.
+ * B/R have bit 2 clear and F/L have it set, so each character is one inverted bit of the ID.
+ * Time complexity: O(n)
+ * Space complexity: O(1)
+ */
+std::size_t seat_id(const char* pass, std::size_t length) {
+	std::size_t id = 0;
+	std::size_t i = 0;
+
+	for (; i + 8 <= length; i += 8) {
+		std::uint64_t word;
+		std::memcpy(&word, pass + i, sizeof(word));
+
+		// gather bit 2 of each byte into one byte, first character as the most significant bit
+		std::uint64_t bits = (~word >> 2) & 0x0101010101010101UL;
+		id = (id << 8) | ((bits * 0x8040201008040201UL) >> 56);
+	}
+
+	for (; i < length; i++) {
+		id = (id << 1) | ((~pass[i] >> 2) & 1);
 	}
 
-	throw new std::runtime_error("Part 2: No Solution!");
+	return id;
 }
 
-/** Returns the underlying value of a string (binary space partitioning).
+/** Checks that a boarding pass only holds F, B, L and R, eight characters per step.
  * Time complexity: O(n)
  * Space complexity: O(1)
  */
-std::size_t bsp(const std::string& data, char lowerChar) {
+bool is_pass(std::string_view pass) {
+	constexpr std::uint64_t ones = 0x0101010101010101UL;
+	constexpr std::uint64_t low = 0x7F7F7F7F7F7F7F7FUL;
+
+	// bit 7 of each byte is set iff that byte of word is zero
+	auto zeros = [](std::uint64_t word) {
+		return ~(((word & low) + low) | word | low);
+	};
+
 	std::size_t i = 0;
-	std::size_t j = (1 << data.size()) - 1;
 
-	for (char ch : data) {
-		std::size_t k = (i + j) / 2;
+	for (; i + 8 <= pass.size(); i += 8) {
+		std::uint64_t word;
+		std::memcpy(&word, pass.data() + i, sizeof(word));
+		std::uint64_t matched = zeros(word ^ ('F' * ones)) | zeros(word ^ ('B' * ones))
+			| zeros(word ^ ('L' * ones)) | zeros(word ^ ('R' * ones));
+
+		if (matched != ~low) {
+			return false;
+		}
+	}
+
+	for (; i < pass.size(); i++) {
+		char ch = pass[i];
 
-		if (ch == lowerChar) {
-			j = k;
-		} else {
-			i = 1 + k;
+		if (ch != 'F' && ch != 'B' && ch != 'L' && ch != 'R') {
+			return false;
 		}
 	}
 
-	return j;
+	return true;
 }
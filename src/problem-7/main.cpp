@@ -1,165 +1,665 @@
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <numeric>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 #include <vector>
 #include "dataset.hpp"
+#include "int128.hpp"
 
-struct constraint {
+/** Interns bag names (views into the dataset buffer) as dense ids with an open-addressing table.
+ * Slots are probed linearly from the name's hash and keep a copy of the name's first bytes,
+ * so most lookups are decided by a single cache line without touching the name itself.
+ */
+class bag_names {
+public:
+	std::size_t intern(std::string_view name) {
+		if (2 * (names.size() + 1) > slots.size()) {
+			grow();
+		}
+
+		std::size_t slot = find_slot(name);
+
+		if (slots[slot].id == 0) {
+			names.push_back(name);
+			slots[slot] = make_entry(name, names.size());
+		}
+
+		return slots[slot].id - 1;
+	}
+
+	std::size_t at(std::string_view name) const {
+		std::size_t slot = slots.empty() ? 0 : find_slot(name);
+
+		if (slots.empty() || slots[slot].id == 0) {
+			throw std::out_of_range("unknown bag: " + std::string(name));
+		}
+
+		return slots[slot].id - 1;
+	}
+
+	std::size_t size() const {
+		return names.size();
+	}
+
+	void reserve(std::size_t count) {
+		names.reserve(count);
+
+		while (2 * count > slots.size()) {
+			grow();
+		}
+	}
+
+private:
+	static constexpr std::size_t prefix_length = 24;
+
+	// id is 1 + the bag id, 0 if the slot is empty
+	struct slot_entry {
+		std::uint32_t id;
+		std::uint32_t length;
+		char prefix[prefix_length];
+	};
+
+	std::vector<std::string_view> names;
+	std::vector<slot_entry> slots;
+
+	static std::uint64_t hash(std::string_view name) {
+		std::uint64_t hash = name.size() * 0x9E3779B97F4A7C15UL;
+
+		for (std::size_t i = 0; i < name.size(); i += 8) {
+			std::uint64_t word = 0;
+			std::memcpy(&word, name.data() + i, std::min<std::size_t>(8, name.size() - i));
+			hash = (hash ^ word) * 0xBF58476D1CE4E5B9UL;
+			hash ^= hash >> 31;
+		}
+
+		return hash;
+	}
+
+	static slot_entry make_entry(std::string_view name, std::size_t id) {
+		slot_entry entry {};
+		entry.id = static_cast<std::uint32_t>(id);
+		entry.length = static_cast<std::uint32_t>(name.size());
+		std::memcpy(entry.prefix, name.data(), std::min(prefix_length, name.size()));
+		return entry;
+	}
+
+	bool matches(const slot_entry& entry, std::string_view name) const {
+		return entry.length == name.size()
+			&& std::memcmp(entry.prefix, name.data(), std::min(prefix_length, name.size())) == 0
+			&& (name.size() <= prefix_length || names[entry.id - 1] == name);
+	}
+
+	std::size_t find_slot(std::string_view name) const {
+		std::size_t mask = slots.size() - 1;
+		std::size_t slot = hash(name) & mask;
+
+		while (slots[slot].id != 0 && !matches(slots[slot], name)) {
+			slot = (slot + 1) & mask;
+		}
+
+		return slot;
+	}
+
+	void grow() {
+		slots.assign(std::max<std::size_t>(64, 2 * slots.size()), slot_entry {});
+
+		for (std::size_t id = 0; id < names.size(); id++) {
+			slots[find_slot(names[id])] = make_entry(names[id], id + 1);
+		}
+	}
+};
+
+struct rule {
 	std::size_t bag;
-	std::string name;
-	std::unordered_set<std::size_t> parents;
-	std::unordered_map<std::size_t, long> children;
+	std::size_t child;
+	long count;
+};
+
+struct input {
+	bag_names bags;
+	std::vector<rule> rules;
+};
+
+// compressed sparse rows: the children of bag i are children[child_offsets[i] .. child_offsets[i + 1]) (same for parents)
+struct bag_graph {
+	std::vector<std::size_t> child_offsets;
+	std::vector<std::size_t> children;
+	std::vector<long> counts;
+	std::vector<std::size_t> parent_offsets;
+	std::vector<std::size_t> parents;
+	std::vector<std::size_t> order; // every bag after all of its parents
+};
+
+// per-bag answers, overflowed[i] is set if contents[i] does not fit
+struct bag_index {
+	std::vector<std::size_t> containers;
+	std::vector<uint128> contents;
+	std::vector<bool> overflowed;
 };
 
-using input = std::vector<constraint>;
-using mapping = std::unordered_map<std::string, std::size_t>;
+static std::size_t part1(const bag_graph& graph, const bag_names& bags);
+static uint128 part2(const bag_graph& graph, const bag_names& bags);
+static bag_graph freeze(const input& input);
+static bag_index build_index(const bag_graph& graph);
 
-static std::size_t part1(const input& input, const mapping& mapping);
-static std::size_t part2(const input& input, const mapping& mapping);
+template<typename ForEachParent>
+static void count_containers(
+	const std::vector<std::size_t>& region,
+	ForEachParent forEachParent,
+	std::vector<std::size_t>& position,
+	std::vector<std::size_t>& containers
+);
 
-/** Grammar
+template<typename ForEachChild>
+static void count_contents(const std::vector<std::size_t>& region, ForEachChild forEachChild, bag_index& index);
+
+/** Bag graph that takes single rule changes and keeps its bag_index identical to a full rebuild.
+ * A change only recounts the bags it can affect: the contents of the changed bag and its ancestors,
+ * and, if a containment was added or removed, the containers of the child, its descendants and their ancestors.
+ */
+class bag_rules {
+public:
+	explicit bag_rules(const bag_graph& graph)
+		: children(graph.order.size()),
+		parents(graph.order.size()),
+		answers(build_index(graph)),
+		scratch(graph.order.size()),
+		marks(graph.order.size(), false) {
+		for (std::size_t bag = 0; bag < children.size(); bag++) {
+			for (std::size_t k = graph.child_offsets[bag]; k < graph.child_offsets[bag + 1]; k++) {
+				children[bag].emplace_back(graph.children[k], graph.counts[k]);
+				parents[graph.children[k]].push_back(bag);
+			}
+		}
+	}
+
+	const bag_index& index() const {
+		return answers;
+	}
+
+	std::size_t add_bag() {
+		children.emplace_back();
+		parents.emplace_back();
+		answers.containers.push_back(0);
+		answers.contents.push_back(0);
+		answers.overflowed.push_back(false);
+		scratch.push_back(0);
+		marks.push_back(false);
+		return children.size() - 1;
+	}
+
+	/** Sets how many child bags one bag directly contains, a count of 0 removes the rule.
+	 * Throws if the rule would let a bag eventually contain itself.
+	 */
+	void set_rule(std::size_t bag, std::size_t child, long count) {
+		if (bag >= children.size() || child >= children.size() || count < 0) {
+			throw std::out_of_range("invalid rule");
+		}
+
+		auto& rules = children[bag];
+		auto iter = std::find_if(rules.begin(), rules.end(), [child](const auto& rule) { return rule.first == child; });
+		bool reachabilityChanged = (iter == rules.end()) != (count == 0);
+
+		if (iter == rules.end() && count > 0) {
+			auto reachable = descendants(child);
+
+			if (std::find(reachable.begin(), reachable.end(), bag) != reachable.end()) {
+				throw std::runtime_error("rule would create a cycle");
+			}
+
+			rules.emplace_back(child, count);
+			parents[child].push_back(bag);
+		} else if (iter != rules.end() && count == 0) {
+			rules.erase(iter);
+			parents[child].erase(std::find(parents[child].begin(), parents[child].end(), bag));
+		} else if (iter != rules.end()) {
+			iter->second = count;
+		}
+
+		if (reachabilityChanged) {
+			count_containers(ancestors(descendants(child)), [this](std::size_t current, auto&& visit) {
+				for (std::size_t parent : parents[current]) {
+					visit(parent);
+				}
+			}, scratch, answers.containers);
+		}
+
+		count_contents(ancestors({ bag }), [this](std::size_t current, auto&& visit) {
+			for (auto [child, count] : children[current]) {
+				visit(child, count);
+			}
+		}, answers);
+	}
+
+private:
+	std::vector<std::vector<std::pair<std::size_t, long>>> children;
+	std::vector<std::vector<std::size_t>> parents;
+	bag_index answers;
+	std::vector<std::size_t> scratch;
+	std::vector<bool> marks;
+
+	// bag and everything it eventually contains
+	std::vector<std::size_t> descendants(std::size_t bag) {
+		std::vector<std::size_t> found({ bag });
+		marks[bag] = true;
+
+		for (std::size_t i = 0; i < found.size(); i++) {
+			for (auto [child, count] : children[found[i]]) {
+				if (!marks[child]) {
+					marks[child] = true;
+					found.push_back(child);
+				}
+			}
+		}
+
+		for (std::size_t node : found) {
+			marks[node] = false;
+		}
+
+		return found;
+	}
+
+	// seeds and every bag that eventually contains one of them, parents first
+	std::vector<std::size_t> ancestors(const std::vector<std::size_t>& seeds) {
+		std::vector<std::size_t> found;
+
+		for (std::size_t bag : seeds) {
+			if (!marks[bag]) {
+				marks[bag] = true;
+				found.push_back(bag);
+			}
+		}
+
+		for (std::size_t i = 0; i < found.size(); i++) {
+			for (std::size_t parent : parents[found[i]]) {
+				if (!marks[parent]) {
+					marks[parent] = true;
+					found.push_back(parent);
+				}
+			}
+		}
+
+		// Kahn's algorithm within the region, every parent of a region bag is in the region
+		std::vector<std::size_t> order;
+		order.reserve(found.size());
+
+		for (std::size_t bag : found) {
+			scratch[bag] = parents[bag].size();
+
+			if (scratch[bag] == 0) {
+				order.push_back(bag);
+			}
+		}
+
+		for (std::size_t i = 0; i < order.size(); i++) {
+			for (auto [child, count] : children[order[i]]) {
+				if (marks[child] && --scratch[child] == 0) {
+					order.push_back(child);
+				}
+			}
+		}
+
+		for (std::size_t bag : found) {
+			marks[bag] = false;
+		}
+
+		return order;
+	}
+};
+
+/** Grammar, words are separated by ' ', '\t' or '\r' and a constraint never spans lines
  * constraint = bag "contains?" bag_list '\n';
  * bag = WORD WORD "bags?";
  * bag_list = LONG bag '.' | LONG bag ',' bag_list | "no other bags.";
  */
 int main() {
-	auto stream = open_dataset("data/problem-7.txt");
+	std::string buffer = read_dataset("data/problem-7.txt");
+	std::string_view data(buffer);
 	input input;
-	mapping mapping;
+	std::size_t pos = 0;
+
+	// every bag has its own rule line
+	input.bags.reserve(std::count(data.begin(), data.end(), '\n') + 1);
+
+	std::size_t lineStart = 0;
+
+	auto isBlank = [](char ch) {
+		return ch == ' ' || ch == '\r' || ch == '\t';
+	};
+
+	auto malformed = [&]() {
+		auto line = data.substr(lineStart, data.find('\n', lineStart) - lineStart);
+		return std::runtime_error("malformed rule: " + std::string(line));
+	};
+
+	// next word on the current line, words never continue past a newline
+	auto nextWord = [&]() {
+		while (pos < data.size() && isBlank(data[pos])) {
+			pos++;
+		}
 
-	auto recordBag = [&, id = static_cast<std::size_t>(0)](const std::string& name) mutable {
-		if (mapping.count(name) == 0) {
-			input.push_back({ id, name, {}, {} });
-			mapping[name] = id;
-			return id++;
-		} else {
-			return mapping.at(name);
+		std::size_t begin = pos;
+
+		while (pos < data.size() && !isBlank(data[pos]) && data[pos] != '\n') {
+			pos++;
+		}
+
+		if (pos == begin) {
+			throw malformed();
 		}
+
+		return data.substr(begin, pos - begin);
 	};
 
-	// bag = WORD WORD "bags?"
+	// bag = WORD WORD "bags?", returns the bag and the ',' or '.' that ended it (0 if none)
 	auto parseBag = [&]() {
-		std::string adjective, color, terminator;
-		stream >> adjective >> color >> terminator;
-		std::string name = adjective + " " + color;
-		char last = terminator.at(terminator.size() - 1);
+		auto adjective = nextWord();
+		auto color = nextWord();
+		auto terminator = nextWord();
+		char last = terminator.back();
+		char punctuation = last == ',' || last == '.' ? last : 0;
+
+		if (punctuation != 0) {
+			terminator.remove_suffix(1);
+		}
 
-		if (last == ',' || last == '.') {
-			stream.unget();
+		// the name is interned as a view, so it must be exactly "adjective color"
+		auto name = data.substr(adjective.data() - data.data(), color.data() + color.size() - adjective.data());
+
+		if (name.size() != adjective.size() + 1 + color.size() || (terminator != "bag" && terminator != "bags")) {
+			throw malformed();
 		}
 
-		return recordBag(name);
+		return std::pair(input.bags.intern(name), punctuation);
 	};
 
 	// bag_list = LONG bag '.' | LONG bag ',' bag_list | "no other bags."
-	auto parseBagList = [&]() {
-		std::unordered_map<std::size_t, long> children;
-		std::string count;
-
-		stream >> count;
-
-		if (count == "no") {
-			// "no other bags."
-			stream >> count; // skip "other"
-			stream >> count; // skip "bags."
-		} else {
-			auto bag = parseBag();
-
-			while (stream.peek() == ',') {
-				// LONG bag ','
-				children[bag] = std::stol(count);
-				stream.get(); // skip ','
-				stream >> count;
-				bag = parseBag();
+	auto parseBagList = [&](std::size_t bag) {
+		auto word = nextWord();
+
+		if (word == "no") {
+			if (nextWord() != "other" || nextWord() != "bags.") {
+				throw malformed();
 			}
 
-			// LONG BAG '.'
-			children.insert({ bag, std::stol(count) });
-			children[bag] = std::stol(count);
-			stream.get(); // skip '.'
+			return;
 		}
 
-		return children;
+		while (true) {
+			long count = 0;
+
+			if (word.size() > 18 || word.find_first_not_of("0123456789") != std::string_view::npos) {
+				throw malformed();
+			}
+
+			for (char ch : word) {
+				count = count * 10 + (ch - '0');
+			}
+
+			auto [child, punctuation] = parseBag();
+			input.rules.push_back({ bag, child, count });
+
+			if (punctuation == '.') {
+				break;
+			} else if (punctuation != ',') {
+				throw malformed();
+			}
+
+			word = nextWord();
+		}
 	};
 
 	// constraint = bag "contains?" bag_list '\n';
-	auto parseConstraint = [&]() {
-		std::string temp;
-		auto bag = parseBag();
-		stream >> temp; // skip "contains?"
-		input.at(bag).children = parseBagList();
-		stream.ignore(1, '\n'); // skip '\n'
-
-		// assign parents
-		std::for_each(
-			input.at(bag).children.begin(),
-			input.at(bag).children.end(),
-			[&](const auto& pair) { input.at(pair.first).parents.insert(bag); }
-		);
-	};
+	while (true) {
+		while (pos < data.size() && (isBlank(data[pos]) || data[pos] == '\n')) {
+			pos++;
+		}
+
+		if (pos == data.size()) {
+			break;
+		}
+
+		lineStart = pos;
+		auto [bag, punctuation] = parseBag();
+		auto verb = nextWord();
+
+		if (punctuation != 0 || (verb != "contain" && verb != "contains")) {
+			throw malformed();
+		}
 
-	while (stream.peek() != std::ifstream::traits_type::eof()) {
-		parseConstraint();
+		parseBagList(bag);
 
-		if (stream.peek() == '\n') {
-			stream.get();
+		// nothing may follow the '.' on the same line
+		while (pos < data.size() && isBlank(data[pos])) {
+			pos++;
+		}
+
+		if (pos < data.size() && data[pos] != '\n') {
+			throw malformed();
 		}
 	}
 
-	std::cout << "Part 1 Solution: " << part1(input, mapping) << "\n";
-	std::cout << "Part 2 Solution: " << part2(input, mapping) << "\n";
+	auto graph = freeze(input);
+	std::cout << "Part 1 Solution: " << part1(graph, input.bags) << "\n";
+	std::cout << "Part 2 Solution: " << part2(graph, input.bags) << "\n";
 	return 0;
 }
 
 /** Counts the number of bags that eventually contain one shiny gold bag.
- * Time complexity: O(n)
+ * Only searches up from shiny gold, build_index answers every bag at once when there are many queries.
+ * Time complexity: O(n + e)
  * Space complexity: O(n)
 */
-std::size_t part1(const input& input, const mapping& mapping) {
-	std::unordered_set<std::size_t> ancestors;
-	std::vector<std::size_t> scan;
-	scan.push_back(mapping.at("shiny gold"));
+std::size_t part1(const bag_graph& graph, const bag_names& bags) {
+	std::vector<bool> seen(graph.order.size(), false);
+	std::vector<std::size_t> scan({ bags.at("shiny gold") });
+	std::size_t containers = 0;
 
-	// get ancestors (no cycles)
 	while (!scan.empty()) {
-		const auto& constraint = input.at(scan.back());
+		std::size_t bag = scan.back();
 		scan.pop_back();
 
-		for (const auto& parent : constraint.parents) {
-			if (ancestors.count(parent) == 0) {
-				ancestors.insert(parent);
+		for (std::size_t k = graph.parent_offsets[bag]; k < graph.parent_offsets[bag + 1]; k++) {
+			std::size_t parent = graph.parents[k];
+
+			if (!seen[parent]) {
+				seen[parent] = true;
+				containers += 1;
 				scan.push_back(parent);
 			}
 		}
 	}
 
-	return ancestors.size();
+	return containers;
 }
 
 /** Counts the total number of bags that one shiny gold bag will contain.
- * Time complexity: O(n)
+ * One pass over the bags children first, without the container sets build_index also computes.
+ * Time complexity: O(n + e)
  * Space complexity: O(n)
 */
-std::size_t part2(const input& input, const mapping& mapping) {
-	std::vector<decltype(constraint::children)::value_type> scan;
-	std::size_t total = 0;
-	scan.emplace_back(mapping.at("shiny gold"), 1);
+uint128 part2(const bag_graph& graph, const bag_names& bags) {
+	std::size_t n = graph.order.size();
+	std::size_t bag = bags.at("shiny gold");
+	bag_index index { {}, std::vector<uint128>(n, 0), std::vector<bool>(n, false) };
 
-	// get descendants and count (no cycles)
-	while (!scan.empty()) {
-		auto [bag, count] = scan.back();
-		total += count;
-		scan.pop_back();
+	count_contents(graph.order, [&graph](std::size_t current, auto&& visit) {
+		for (std::size_t k = graph.child_offsets[current]; k < graph.child_offsets[current + 1]; k++) {
+			visit(graph.children[k], graph.counts[k]);
+		}
+	}, index);
+
+	if (index.overflowed[bag]) {
+		throw std::overflow_error("Part 2: Overflow!");
+	}
+
+	return index.contents[bag];
+}
 
-		// add children bag count
-		for (auto [child, childCount] : input.at(bag).children) {
-			std::size_t totalCount = count * childCount;
-			scan.emplace_back(child, totalCount);
+/** Freezes the parsed rules into parent and child arrays and orders the bags topologically.
+ * Time complexity: O(n)
+ * Space complexity: O(n)
+ */
+bag_graph freeze(const input& input) {
+	std::size_t n = input.bags.size();
+	bag_graph graph;
+	graph.child_offsets.assign(n + 1, 0);
+	graph.parent_offsets.assign(n + 1, 0);
+
+	for (const auto& rule : input.rules) {
+		graph.child_offsets[rule.bag + 1] += 1;
+		graph.parent_offsets[rule.child + 1] += 1;
+	}
+
+	std::partial_sum(graph.child_offsets.begin(), graph.child_offsets.end(), graph.child_offsets.begin());
+	std::partial_sum(graph.parent_offsets.begin(), graph.parent_offsets.end(), graph.parent_offsets.begin());
+	graph.children.resize(graph.child_offsets[n]);
+	graph.counts.resize(graph.child_offsets[n]);
+	graph.parents.resize(graph.parent_offsets[n]);
+	std::vector<std::size_t> nextChild(graph.child_offsets.begin(), graph.child_offsets.end() - 1);
+	std::vector<std::size_t> nextParent(graph.parent_offsets.begin(), graph.parent_offsets.end() - 1);
+
+	for (const auto& rule : input.rules) {
+		std::size_t k = nextChild[rule.bag]++;
+		graph.children[k] = rule.child;
+		graph.counts[k] = rule.count;
+		graph.parents[nextParent[rule.child]++] = rule.bag;
+	}
+
+	// Kahn's algorithm, a bag becomes ready once all of its parents are placed
+	std::vector<std::size_t> pending(n);
+	graph.order.reserve(n);
+
+	for (std::size_t bag = 0; bag < n; bag++) {
+		pending[bag] = graph.parent_offsets[bag + 1] - graph.parent_offsets[bag];
+
+		if (pending[bag] == 0) {
+			graph.order.push_back(bag);
+		}
+	}
+
+	for (std::size_t i = 0; i < graph.order.size(); i++) {
+		std::size_t bag = graph.order[i];
+
+		for (std::size_t k = graph.child_offsets[bag]; k < graph.child_offsets[bag + 1]; k++) {
+			if (--pending[graph.children[k]] == 0) {
+				graph.order.push_back(graph.children[k]);
+			}
 		}
 	}
 
-	// exclude the shiny gold bag itself
-	return total - 1;
+	if (graph.order.size() != n) {
+		throw std::runtime_error("bag constraints contain a cycle");
+	}
+
+	return graph;
+}
+
+/** Answers both questions for every bag.
+ * Time complexity: O(n + e * n / 64)
+ * Space complexity: O(n + min(n^2 / 64, blockBudget))
+ */
+bag_index build_index(const bag_graph& graph) {
+	std::size_t n = graph.order.size();
+	bag_index index { std::vector<std::size_t>(n, 0), std::vector<uint128>(n, 0), std::vector<bool>(n, false) };
+	std::vector<std::size_t> position(n);
+
+	count_containers(graph.order, [&graph](std::size_t bag, auto&& visit) {
+		for (std::size_t k = graph.parent_offsets[bag]; k < graph.parent_offsets[bag + 1]; k++) {
+			visit(graph.parents[k]);
+		}
+	}, position, index.containers);
+
+	count_contents(graph.order, [&graph](std::size_t bag, auto&& visit) {
+		for (std::size_t k = graph.child_offsets[bag]; k < graph.child_offsets[bag + 1]; k++) {
+			visit(graph.children[k], graph.counts[k]);
+		}
+	}, index);
+
+	return index;
+}
+
+/** Recounts the containers of every bag in region.
+ * region lists bags parents first and holds every ancestor of its bags, forEachParent(bag, visit) calls visit(parent).
+ * Ancestor sets are built as bitset rows over region positions, 64 * blockWords columns per pass,
+ * so the rows never take more than about blockBudget words however large the region is.
+ * position is scratch space indexed by bag.
+ * Time complexity: O(r + e * r / 64) [r = region size, e = edges within it]
+ * Space complexity: O(r + min(r^2 / 64, blockBudget))
+ */
+template<typename ForEachParent>
+void count_containers(
+	const std::vector<std::size_t>& region,
+	ForEachParent forEachParent,
+	std::vector<std::size_t>& position,
+	std::vector<std::size_t>& containers
+) {
+	constexpr std::size_t blockBudget = 1 << 23;
+	std::size_t n = region.size();
+	std::size_t blockWords = std::max<std::size_t>(1, std::min((n + 63) / 64, blockBudget / std::max<std::size_t>(n, 1)));
+	std::vector<std::uint64_t> rows(n * blockWords);
+
+	for (std::size_t i = 0; i < n; i++) {
+		position[region[i]] = i;
+		containers[region[i]] = 0;
+	}
+
+	for (std::size_t first = 0; first < n; first += 64 * blockWords) {
+		std::fill(rows.begin(), rows.end(), 0);
+
+		for (std::size_t i = 0; i < n; i++) {
+			std::uint64_t* row = &rows[i * blockWords];
+
+			forEachParent(region[i], [&](std::size_t parent) {
+				std::size_t j = position[parent];
+				const std::uint64_t* parentRow = &rows[j * blockWords];
+
+				for (std::size_t w = 0; w < blockWords; w++) {
+					row[w] |= parentRow[w];
+				}
+
+				if (j >= first && j - first < 64 * blockWords) {
+					row[(j - first) / 64] |= 1UL << ((j - first) % 64);
+				}
+			});
+
+			for (std::size_t w = 0; w < blockWords; w++) {
+				containers[region[i]] += __builtin_popcountll(row[w]);
+			}
+		}
+	}
+}
+
+/** Recounts the contents of every bag in region, children first.
+ * region lists bags parents first, forEachChild(bag, visit) calls visit(child, count),
+ * and children outside of region must already be counted.
+ * Time complexity: O(r + e) [r = region size, e = edges out of it]
+ * Space complexity: O(1)
+ */
+template<typename ForEachChild>
+void count_contents(const std::vector<std::size_t>& region, ForEachChild forEachChild, bag_index& index) {
+	for (auto iter = region.rbegin(); iter != region.rend(); ++iter) {
+		std::size_t bag = *iter;
+		uint128 total = 0;
+		bool overflowed = false;
+
+		// each child bag holds itself plus everything it contains
+		forEachChild(bag, [&](std::size_t child, long count) {
+			uint128 bags = 0;
+
+			overflowed = overflowed
+				|| index.overflowed[child]
+				|| __builtin_add_overflow(index.contents[child], 1, &bags)
+				|| __builtin_mul_overflow(bags, static_cast<uint128>(count), &bags)
+				|| __builtin_add_overflow(total, bags, &total);
+		});
+
+		// the partial total depends on child order, keep it canonical
+		index.contents[bag] = overflowed ? 0 : total;
+		index.overflowed[bag] = overflowed;
+	}
 }
@@ -1,48 +1,83 @@
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 #include <vector>
 #include "dataset.hpp"
 
 struct state {
 	long acc;
 	std::size_t pc;
-	std::unordered_multiset<std::size_t> pc_history;
 };
 
-enum class opcode { acc, jmp, nop };
+enum class opcode : std::uint8_t { acc, jmp, nop };
 
 struct instruction {
 	typename ::opcode opcode;
-	long argument;
+	std::int32_t argument;
 };
 
 using input = std::vector<instruction>;
 
-static std::unordered_map<std::string, opcode> mapping({
-	{ "acc", opcode::acc },
-	{ "jmp", opcode::jmp },
-	{ "nop", opcode::nop }
-});
+// the first jmp/nop on the original path whose flip terminates, candidates counts every such flip
+struct repair {
+	std::size_t pc;
+	std::size_t candidates;
+};
+
+// straight-line run starting at pc begin: adds acc, then continues at pc exit (block next, or npos if exit leaves the program)
+struct block {
+	std::size_t begin;
+	long acc;
+	std::size_t exit;
+	std::size_t next;
+};
+
+using block_program = std::vector<block>;
+
+constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+// visits[pc] == generation iff pc already ran in the current execution, so bumping generation clears every mark
+struct visit_log {
+	std::vector<std::uint32_t> visits;
+	std::uint32_t generation;
+};
 
 static long part1(const input& input);
 static long part2(const input& input);
-static state execute(const input& input, std::size_t execInstrLimit);
+static state execute(const input& input, visit_log& log);
+static state execute_blocks(const block_program& program, visit_log& log);
+static block_program compile_blocks(const input& input);
+static repair find_repair(const input& input);
 
 int main() {
-	auto stream = open_dataset("data/problem-8.txt");
+	std::string buffer = read_dataset("data/problem-8.txt");
+	std::string_view data(buffer);
 	input input;
 
-	while (stream.peek() != std::ifstream::traits_type::eof()) {
-		std::string opcodeName;
-		long argument;
-		stream >> opcodeName >> argument;
-		input.push_back({ mapping.at(opcodeName), argument });
+	for (std::size_t i = 0; i + 3 < data.size();) {
+		// acc +1
+		auto name = data.substr(i, 3);
+		opcode opcode = name == "acc" ? opcode::acc : name == "jmp" ? opcode::jmp : opcode::nop;
+
+		if (opcode == opcode::nop && name != "nop") {
+			throw std::runtime_error("unknown opcode: " + std::string(name));
+		}
+
+		i += 4;
+		bool negative = data[i++] == '-';
+		std::int32_t argument = 0;
+
+		while (i < data.size() && data[i] >= '0' && data[i] <= '9') {
+			argument = argument * 10 + (data[i++] - '0');
+		}
+
+		input.push_back({ opcode, negative ? -argument : argument });
 
-		if (stream.peek() == '\n') {
-			stream.get();
+		while (i < data.size() && data[i] == '\n') {
+			i++;
 		}
 	}
 
@@ -56,60 +91,234 @@ int main() {
  * Space complexity: O(n)
 */
 long part1(const input& input) {
-	return execute(input, 1).acc;
+	auto program = compile_blocks(input);
+	visit_log log { std::vector<std::uint32_t>(program.size(), 0), 0 };
+	return execute_blocks(program, log).acc;
 }
 
 /** Return the accumulator after replacing a single jmp/nop with a nop/jmp such that pc is at one after the end.
- * Time complexity: O(mn) [m = pc history limit]
- * Space complexity: O(mn)
+ * Time complexity: O(n)
+ * Space complexity: O(n)
 */
 long part2(const input& input) {
+	auto [pc, candidates] = find_repair(input);
+
+	if (candidates == 0) {
+		throw std::runtime_error("Part 2: No Solution!");
+	}
+
 	std::vector<instruction> copy(input);
-	std::size_t pcHistoryLimit = 100;
+	visit_log log { std::vector<std::uint32_t>(input.size(), 0), 0 };
+	copy[pc].opcode = copy[pc].opcode == opcode::jmp ? opcode::nop : opcode::jmp;
+	return execute(copy, log).acc;
+}
+
+/** Finds the jmp/nop to flip so the program terminates by analysing the control-flow graph once.
+ * Every pc that reaches the end is found by searching backwards from pc = n over the reversed edges.
+ * Only a flip on the original (looping) path changes execution, and it repairs the program iff its new target
+ * is one of those pcs. That path cannot return to the flipped pc: the flip would then terminate unflipped too.
+ * Time complexity: O(n)
+ * Space complexity: O(n)
+ */
+repair find_repair(const input& input) {
+	std::size_t size = input.size();
+
+	auto next = [&input](std::size_t pc, opcode opcode) {
+		return opcode == opcode::jmp ? pc + input[pc].argument : pc + 1;
+	};
+
+	// reverse edges in compressed sparse rows, predecessors of pc are sources[offsets[pc] .. offsets[pc + 1])
+	std::vector<std::size_t> offsets(size + 2, 0);
+	std::vector<std::size_t> sources(size);
+
+	for (std::size_t pc = 0; pc < size; pc++) {
+		std::size_t target = next(pc, input[pc].opcode);
+
+		if (target <= size) {
+			offsets[target + 1] += 1;
+		}
+	}
+
+	for (std::size_t pc = 0; pc <= size; pc++) {
+		offsets[pc + 1] += offsets[pc];
+	}
+
+	std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+
+	for (std::size_t pc = 0; pc < size; pc++) {
+		std::size_t target = next(pc, input[pc].opcode);
+
+		if (target <= size) {
+			sources[fill[target]++] = pc;
+		}
+	}
+
+	// every pc that runs into pc = size
+	std::vector<bool> terminates(size + 1, false);
+	std::vector<std::size_t> scan({ size });
+	terminates[size] = true;
+
+	while (!scan.empty()) {
+		std::size_t pc = scan.back();
+		scan.pop_back();
 
-	for (std::size_t i = 0; i < copy.size(); i++) {
-		opcode opcode = copy[i].opcode;
+		for (std::size_t k = offsets[pc]; k < offsets[pc + 1]; k++) {
+			if (!terminates[sources[k]]) {
+				terminates[sources[k]] = true;
+				scan.push_back(sources[k]);
+			}
+		}
+	}
+
+	// walk the original path once
+	repair repair { size, 0 };
+	std::vector<bool> visited(size, false);
+
+	for (std::size_t pc = 0; pc < size && !visited[pc]; pc = next(pc, input[pc].opcode)) {
+		visited[pc] = true;
+		opcode opcode = input[pc].opcode;
 
 		if (opcode == opcode::jmp || opcode == opcode::nop) {
-			auto newOpcode = opcode == opcode::jmp ? opcode::nop : opcode::jmp;
-			copy[i].opcode = newOpcode; // replace jmp/nop with nop/jmp
-			auto state = execute(copy, pcHistoryLimit);
-			copy[i].opcode = opcode; // undo change
+			std::size_t target = next(pc, opcode == opcode::jmp ? opcode::nop : opcode::jmp);
 
-			if (state.pc == input.size()) {
-				return state.acc;
+			if (target <= size && terminates[target]) {
+				repair.pc = repair.candidates == 0 ? pc : repair.pc;
+				repair.candidates += 1;
 			}
 		}
 	}
 
-	throw std::runtime_error("Part 2: No Solution!");
+	return repair;
+}
+
+/** Splits the instructions into basic blocks and links each block to the block it continues into.
+ * A block starts at pc 0, at every jmp target and after every jmp, and ends with a jmp or before the next start.
+ * Time complexity: O(n)
+ * Space complexity: O(n)
+ */
+block_program compile_blocks(const input& input) {
+	std::size_t size = input.size();
+	std::vector<std::uint8_t> leaders(size + 1, 0);
+	std::vector<std::uint32_t> blockAt(size, 0);
+	block_program program;
+	leaders[0] = 1;
+
+	for (std::size_t pc = 0; pc < size; pc++) {
+		if (input[pc].opcode == opcode::jmp) {
+			std::size_t target = pc + input[pc].argument;
+			leaders[std::min(target, size)] = 1;
+			leaders[pc + 1] = 1;
+		}
+	}
+
+	program.reserve(std::count(leaders.begin(), leaders.end() - 1, 1));
+
+	for (std::size_t pc = 0; pc < size;) {
+		block block { pc, 0, pc, npos };
+		blockAt[pc] = static_cast<std::uint32_t>(program.size());
+
+		// branchless so random acc/nop runs do not mispredict
+		do {
+			block.acc += input[pc].opcode == opcode::acc ? input[pc].argument : 0;
+			pc += 1;
+		} while (pc < size && leaders[pc] == 0);
+
+		const instruction& last = input[pc - 1];
+		block.exit = last.opcode == opcode::jmp ? pc - 1 + last.argument : pc;
+
+		program.push_back(block);
+	}
+
+	for (auto& block : program) {
+		block.next = block.exit < size ? blockAt[block.exit] : npos;
+	}
+
+	return program;
 }
 
-/** Executes the instructions, terminates if the pc history limit is passed for any pc.
- * Time complexity: O(mn) [m = pc history limit]
- * Space complexity: O(mn)
+/** Executes whole blocks until pc leaves the program or a block is about to run twice.
+ * Blocks are only entered at their first instruction, so this stops at the same pc (with the same acc) as execute.
+ * Time complexity: O(b) [b = number of blocks]
+ * Space complexity: O(1)
  */
-state execute(const input& input, std::size_t pcHistoryLimit) {
-	state state({ 0, 0, {} });
+state execute_blocks(const block_program& program, visit_log& log) {
+	long acc = 0;
+
+	if (program.empty()) {
+		return { acc, 0 };
+	}
+
+	if (++log.generation == 0) {
+		// generation wrapped, stale marks could now look current
+		std::fill(log.visits.begin(), log.visits.end(), 0);
+		log.generation = 1;
+	}
 
-	while (state.pc < input.size()) {
-		const auto& instruction = input[state.pc];
+	for (std::size_t current = 0;;) {
+		const block& block = program[current];
 
-		if (state.pc_history.count(state.pc) >= pcHistoryLimit) {
-			break;
+		if (log.visits[current] == log.generation) {
+			return { acc, block.begin };
 		}
 
-		state.pc_history.insert(state.pc);
+		log.visits[current] = log.generation;
+		acc += block.acc;
 
-		if (instruction.opcode == opcode::acc) {
-			state.acc += instruction.argument;
-		} else if (instruction.opcode == opcode::jmp) {
-			state.pc += instruction.argument;
-			continue;
+		if (block.next == npos) {
+			return { acc, block.exit };
 		}
 
-		state.pc += 1;
+		current = block.next;
+	}
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // computed goto
+
+/** Executes the instructions until pc leaves the program or an instruction is about to run twice.
+ * Dispatch jumps straight from one handler to the next through a label table indexed by opcode.
+ * Time complexity: O(n)
+ * Space complexity: O(1)
+ */
+state execute(const input& input, visit_log& log) {
+	static void* const handlers[] = { &&op_acc, &&op_jmp, &&op_nop };
+	const instruction* code = input.data();
+	std::size_t size = input.size();
+	long acc = 0;
+	std::size_t pc = 0;
+
+	if (++log.generation == 0) {
+		// generation wrapped, stale marks could now look current
+		std::fill(log.visits.begin(), log.visits.end(), 0);
+		log.generation = 1;
 	}
 
-	return state;
+	std::uint32_t* visits = log.visits.data();
+	std::uint32_t generation = log.generation;
+
+#define DISPATCH() \
+	if (pc >= size || visits[pc] == generation) { \
+		return { acc, pc }; \
+	} \
+	visits[pc] = generation; \
+	goto *handlers[static_cast<std::size_t>(code[pc].opcode)]
+
+	DISPATCH();
+
+op_acc:
+	acc += code[pc].argument;
+	pc += 1;
+	DISPATCH();
+
+op_jmp:
+	pc += code[pc].argument;
+	DISPATCH();
+
+op_nop:
+	pc += 1;
+	DISPATCH();
+
+#undef DISPATCH
 }
+
+#pragma GCC diagnostic pop
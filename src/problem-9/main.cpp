@@ -1,15 +1,86 @@
 #include <algorithm>
+#include <deque>
 #include <iostream>
 #include <stdexcept>
 #include <string>
-#include <unordered_set>
 #include <vector>
 #include "dataset.hpp"
+#include "flat_hash_map.hpp"
 
 using input = std::vector<long>;
 
-static long part1(const input& input);
+/** The last size values of a stream, in arrival order in a ring buffer and in value order in a sorted array.
+ * Sliding by one value is one erase and one insert into the sorted array, nothing is rebuilt per position.
+ */
+class pair_window {
+public:
+	explicit pair_window(std::size_t size) : values(size), next(0), length(0) {
+		if (size == 0) {
+			throw std::invalid_argument("window size must be positive");
+		}
+
+		sorted.reserve(size);
+	}
+
+	bool full() const {
+		return length == values.size();
+	}
+
+	void push(long value) {
+		if (full()) {
+			sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), values[next]));
+		} else {
+			length += 1;
+		}
+
+		values[next] = value;
+		sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), value), value);
+		next = next + 1 == values.size() ? 0 : next + 1;
+	}
+
+	// true if two different values in the window sum to value, found by closing in from both ends
+	bool has_pair(long value) const {
+		std::size_t low = 0;
+		std::size_t high = sorted.empty() ? 0 : sorted.size() - 1;
+
+		while (low < high) {
+			long sum;
+			bool overflow = __builtin_add_overflow(sorted[low], sorted[high], &sum);
+
+			if (!overflow && sum == value) {
+				// everything in between is equal too
+				return sorted[low] != sorted[high];
+			}
+
+			if (overflow ? sorted[low] > 0 : sum > value) {
+				high -= 1;
+			} else {
+				low += 1;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	std::vector<long> values;
+	std::vector<long> sorted;
+	std::size_t next;
+	std::size_t length;
+};
+
+// input[begin .. end) with its smallest and largest value
+struct range {
+	std::size_t begin;
+	std::size_t end;
+	long min;
+	long max;
+};
+
+static long part1(const input& input, std::size_t preamble);
 static long part2(const input& input, long invalid);
+template<typename Visit>
+static void for_each_range(const input& input, long target, Visit visit);
 
 int main() {
 	auto stream = open_dataset("data/problem-9.txt");
@@ -20,71 +91,123 @@ int main() {
 		input.push_back(value);
 	}
 
-	long part1Solution = part1(input);
+	long part1Solution = part1(input, 25);
 	std::cout << "Part 1 Solution: " << part1Solution << "\n";
 	std::cout << "Part 2 Solution: " << part2(input, part1Solution) << "\n";
 	return 0;
 }
 
-/** Returns true if there are two integers that sum to value.
- * Time complexity: O(n)
- * Space complexity: O(n)
+/** Returns the first number such that it is not a sum of two different numbers among the previous preamble numbers.
+ * Time complexity: O(n * p) [p = preamble]
+ * Space complexity: O(p)
  */
-template<typename Iterator>
-bool has_pair(Iterator begin, Iterator end, long value) {
-	std::unordered_set<long> seen;
+long part1(const input& input, std::size_t preamble) {
+	pair_window window(preamble);
 
-	for (auto iter = begin; iter != end; ++iter) {
-		seen.insert(*iter);
-
-		if (seen.count(value - *iter) > 0) {
-			return true;
+	for (long value : input) {
+		if (window.full() && !window.has_pair(value)) {
+			return value;
 		}
-	}
 
-	return false;
-}
-
-/** Returns the first number such that it is not a sum of the previous 25 numbers.
- * Time complexity: O(n)
- * Space complexity: O(1)
- */
-long part1(const input& input) {
-	for (auto iter = input.begin() + 25; iter != input.end(); ++iter) {
-		// has_pair is O(1) here because the input size is a constant
-		if (!has_pair(iter - 25, iter, *iter)) {
-			return *iter;
-		}
+		window.push(value);
 	}
 
 	throw std::runtime_error("Part 1: No Solution!");
 }
 
 /** Returns the sum of the smallest and largest number in a continuous range of at least 2 values that sum to invalid.
- * Time complexity: O(n^2)
+ * Time complexity: O(n)
  * Space complexity: O(n)
 */
 long part2(const input& input, long invalid) {
-	long total = 0;
-	std::vector<long> values;
-	std::size_t last = 0;
+	long solution = 0;
+	bool found = false;
 
-	for (std::size_t i = 0; i < input.size(); i++) {
-		total += input[i];
-		values.push_back(input[i]);
+	for_each_range(input, invalid, [&solution, &found](const range& range) {
+		solution = range.min + range.max;
+		found = true;
+		return false;
+	});
 
-		if (values.size() == 1) {
-			last = i + 1;
-		}
+	if (!found) {
+		throw std::runtime_error("Part 2: No Solution!");
+	}
 
-		if (total == invalid && values.size() >= 2) {
-			return *std::min_element(values.begin(), values.end()) + *std::max_element(values.begin(), values.end());
-		} else if (total > invalid) {
-			total = 0;
-			values.clear();
-			i = last;
+	return solution;
+}
+
+/** Calls visit with the longest range [begin, end) of at least 2 values summing to target that ends at each end,
+ * in order of end, until visit returns false. With only positive values that is every such range.
+ * Non-negative values are covered by two pointers, with monotonic deques of indices for the window min/max.
+ * Otherwise the earliest begin with prefix[begin] = prefix[end] - target is looked up in a hash map,
+ * and min/max are scanned over the reported range only.
+ * Time complexity: O(n + r) [r = total length of the reported ranges, 0 for non-negative values]
+ * Space complexity: O(n)
+ */
+template<typename Visit>
+void for_each_range(const input& input, long target, Visit visit) {
+	if (std::all_of(input.begin(), input.end(), [](long value) { return value >= 0; })) {
+		// front of minimums / maximums is the index of the window min / max
+		std::deque<std::size_t> minimums;
+		std::deque<std::size_t> maximums;
+		std::size_t begin = 0;
+		long total = 0;
+
+		for (std::size_t end = 1; end <= input.size(); end++) {
+			long value = input[end - 1];
+			total += value;
+
+			while (!minimums.empty() && input[minimums.back()] >= value) {
+				minimums.pop_back();
+			}
+
+			while (!maximums.empty() && input[maximums.back()] <= value) {
+				maximums.pop_back();
+			}
+
+			minimums.push_back(end - 1);
+			maximums.push_back(end - 1);
+
+			while (total > target && begin < end) {
+				total -= input[begin];
+				begin += 1;
+
+				if (minimums.front() < begin) {
+					minimums.pop_front();
+				}
+
+				if (maximums.front() < begin) {
+					maximums.pop_front();
+				}
+			}
+
+			if (total == target && end - begin >= 2
+				&& !visit(range { begin, end, input[minimums.front()], input[maximums.front()] })
+			) {
+				return;
+			}
 		}
+
+		return;
 	}
 
-	throw std::runtime_error("Part 2 No Solution!");
+	// earliest index of each prefix sum
+	flat_hash_map<long, std::size_t> first;
+	long prefix = 0;
+	first.reserve(input.size() + 1);
+	first.emplace(prefix, 0);
+
+	for (std::size_t end = 1; end <= input.size(); end++) {
+		prefix += input[end - 1];
+		first.emplace(prefix, end);
+		auto iter = first.find(prefix - target);
+
+		if (iter != first.end() && iter->second + 2 <= end) {
+			auto [min, max] = std::minmax_element(input.begin() + iter->second, input.begin() + end);
+
+			if (!visit(range { iter->second, end, *min, *max })) {
+				return;
+			}
+		}
+	}
 }